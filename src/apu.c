@@ -0,0 +1,507 @@
+#include "apu.h"
+
+#include <string.h>
+
+#define FRAME_QUARTER 1 // Envelopes and the triangle's linear counter
+#define FRAME_HALF 2    // Length counters and sweeps
+#define FRAME_IRQ 4
+
+#define SKIP_FAR INT32_MAX // `next` of a channel whose edges are skipped
+
+static const uint8_t lengthTable[32] = {
+    10, 254, 20,  2, 40,  4, 80,  6, 160,  8, 60, 10, 14, 12, 26, 14,
+    12,  16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+};
+
+// Duty patterns as masks applied to the level, so a step needs no branch
+static const uint8_t dutyMask[4][8] = {
+    { 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // 12.5 %
+    { 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00 }, // 25 %
+    { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00 }, // 50 %
+    { 0xFF, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }  // 25 % negated
+};
+
+static const uint8_t triangleSequence[32] = {
+    15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15
+};
+
+// NTSC noise and DMC timer periods in CPU clocks
+static const int32_t noisePeriods[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+};
+static const int32_t dmcPeriods[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+};
+
+// Nonlinear mixer, scaled to blip amplitude (1.0 = 32000):
+// pulseTable[n] = 95.52 / (8128 / n + 100)
+static const int32_t pulseTable[31] = {
+        0,   371,   734,  1088,  1434,  1771,  2101,  2424,  2739,  3047,  3349,  3644,
+     3932,  4215,  4491,  4762,  5027,  5287,  5542,  5791,  6036,  6276,  6511,  6742,
+     6968,  7190,  7408,  7622,  7832,  8038,  8240,
+};
+
+// tndTable[n] = 163.67 / (24329 / n + 100), n = 3 * triangle + 2 * noise + DMC
+static const int32_t tndTable[203] = {
+        0,   214,   427,   638,   847,  1055,  1261,  1465,  1667,  1868,  2068,  2266,
+     2462,  2657,  2850,  3042,  3232,  3421,  3608,  3794,  3978,  4162,  4343,  4524,
+     4703,  4880,  5057,  5232,  5406,  5578,  5749,  5919,  6088,  6256,  6422,  6587,
+     6751,  6914,  7075,  7236,  7395,  7553,  7710,  7866,  8021,  8175,  8328,  8480,
+     8630,  8780,  8929,  9076,  9223,  9369,  9513,  9657,  9800,  9942, 10082, 10222,
+    10361, 10499, 10636, 10773, 10908, 11043, 11176, 11309, 11441, 11572, 11702, 11832,
+    11960, 12088, 12215, 12341, 12467, 12591, 12715, 12838, 12960, 13082, 13203, 13323,
+    13442, 13561, 13679, 13796, 13912, 14028, 14143, 14257, 14371, 14484, 14596, 14708,
+    14819, 14929, 15039, 15148, 15257, 15364, 15472, 15578, 15684, 15789, 15894, 15998,
+    16102, 16205, 16307, 16409, 16510, 16611, 16711, 16811, 16910, 17008, 17106, 17203,
+    17300, 17396, 17492, 17587, 17682, 17776, 17870, 17963, 18056, 18148, 18240, 18331,
+    18422, 18512, 18602, 18691, 18780, 18868, 18956, 19043, 19130, 19217, 19303, 19388,
+    19474, 19558, 19643, 19726, 19810, 19893, 19975, 20058, 20139, 20221, 20302, 20382,
+    20462, 20542, 20621, 20700, 20779, 20857, 20935, 21012, 21089, 21166, 21242, 21318,
+    21393, 21469, 21543, 21618, 21692, 21766, 21839, 21912, 21985, 22057, 22129, 22200,
+    22272, 22343, 22413, 22484, 22554, 22623, 22692, 22761, 22830, 22898, 22966, 23034,
+    23102, 23169, 23235, 23302, 23368, 23434, 23500, 23565, 23630, 23695, 23759,
+};
+
+// Frame sequencer, per mode: CPU clocks from the previous step to each step
+// (the first entry also spans the wrap from the last step), and what each
+// step clocks.
+static const int32_t frameStepGap[2][5] = {
+    { 7458, 7456, 7458, 7458, 0 },
+    { 7458, 7456, 7458, 7458, 7452 }
+};
+static const uint8_t frameStepUnits[2][5] = {
+    { FRAME_QUARTER, FRAME_QUARTER | FRAME_HALF, FRAME_QUARTER, FRAME_QUARTER | FRAME_HALF | FRAME_IRQ, 0 },
+    { FRAME_QUARTER, FRAME_QUARTER | FRAME_HALF, FRAME_QUARTER, 0, FRAME_QUARTER | FRAME_HALF }
+};
+static const uint8_t frameSteps[2] = { 4, 5 };
+#define FRAME_FIRST_STEP 7457 // First step after a $4017 write
+
+// Mixer: each group emits a delta only when its table index changes
+
+static inline void mixPulses(Apu* apu, BlipBuffer* blip, int32_t t) {
+    uint8_t index = apu->pulse[0].output + apu->pulse[1].output;
+    if (index != apu->pulseIndex) {
+        addBlipDelta(blip, (uint32_t)t, pulseTable[index] - pulseTable[apu->pulseIndex]);
+        apu->pulseIndex = index;
+    }
+}
+
+static inline void mixTnd(Apu* apu, BlipBuffer* blip, int32_t t) {
+    uint8_t index = 3 * apu->triangle.output + 2 * apu->noise.output + apu->dmc.output;
+    if (index != apu->tndIndex) {
+        addBlipDelta(blip, (uint32_t)t, tndTable[index] - tndTable[apu->tndIndex]);
+        apu->tndIndex = index;
+    }
+}
+
+// Advances an idle channel's timer to the first edge at or after `end`
+// without visiting the edges in between. Returns the number of edges skipped.
+static inline int32_t skipEdges(int32_t* next, int32_t stepClocks, int32_t end) {
+    if (*next >= end) return 0;
+    int32_t n = (end - *next - 1) / stepClocks + 1;
+    *next += n * stepClocks;
+    return n;
+}
+
+// Pulse channels
+
+static int sweepTarget(const ApuPulse* p) {
+    int change = p->period >> p->sweepShift;
+    if (p->sweepNegate) return p->period - change - (p->onesComplement ? 1 : 0);
+    return p->period + change;
+}
+
+static void refreshPulse(ApuPulse* p) {
+    bool muted = p->length == 0 || p->period < 8 || sweepTarget(p) > 0x7FF;
+    p->level = muted ? 0 : (p->constantVolume ? p->volume : p->envelope.decay);
+    p->stepClocks = 2 * (p->period + 1);
+    p->output = p->level & dutyMask[p->duty][p->step];
+}
+
+static void runPulses(Apu* apu, BlipBuffer* blip, int32_t end) {
+    ApuPulse* p0 = &apu->pulse[0];
+    ApuPulse* p1 = &apu->pulse[1];
+
+    // A silent pulse cannot change its output; only its sequencer position moves
+    if (p0->level == 0) p0->step = (uint8_t)((p0->step + skipEdges(&p0->next, p0->stepClocks, end)) & 7);
+    if (p1->level == 0) p1->step = (uint8_t)((p1->step + skipEdges(&p1->next, p1->stepClocks, end)) & 7);
+
+    for (;;) {
+        ApuPulse* p = p0->next <= p1->next ? p0 : p1;
+        int32_t t = p->next;
+        if (t >= end) break;
+        p->step = (p->step + 1) & 7;
+        p->output = p->level & dutyMask[p->duty][p->step];
+        p->next = t + p->stepClocks;
+        mixPulses(apu, blip, t);
+    }
+}
+
+// Triangle, noise and DMC
+
+static inline bool triangleHalted(const ApuTriangle* tri) {
+    // Periods below 2 are ultrasonic; holding the sequencer avoids popping
+    // and a flood of edges.
+    return tri->linearCounter == 0 || tri->length == 0 || tri->period < 2;
+}
+
+static inline bool dmcIdle(const ApuDmc* d) {
+    return d->silence && !d->bufferFull && d->bytesRemaining == 0;
+}
+
+static inline void stepDmc(ApuDmc* d, int32_t t) {
+    if (!d->silence) {
+        if (d->shift & 1) {
+            if (d->output <= 125) d->output += 2;
+        } else if (d->output >= 2) {
+            d->output -= 2;
+        }
+        d->shift >>= 1;
+    }
+
+    if (--d->bitsRemaining == 0) {
+        d->bitsRemaining = 8;
+        if (d->bufferFull) {
+            d->shift = d->buffer;
+            d->bufferFull = false;
+            d->silence = false;
+            if (d->bytesRemaining > 0 && d->fetchTime == APU_NO_FETCH) d->fetchTime = t;
+        } else {
+            d->silence = true;
+        }
+    }
+}
+
+static void runTnd(Apu* apu, BlipBuffer* blip, int32_t end) {
+    ApuTriangle* tri = &apu->triangle;
+    ApuNoise* noise = &apu->noise;
+    ApuDmc* dmc = &apu->dmc;
+
+    // Idle channels hold their output. The halted triangle and an idle DMC
+    // really stop; a silent noise channel keeps its timer phase but its shift
+    // register is left where it is, which is inaudible.
+    int32_t triNext = tri->next, noiseNext = noise->next, dmcNext = dmc->next;
+    if (triangleHalted(tri)) {
+        skipEdges(&tri->next, tri->stepClocks, end);
+        triNext = SKIP_FAR;
+    }
+    if (noise->level == 0) {
+        skipEdges(&noise->next, noise->stepClocks, end);
+        noiseNext = SKIP_FAR;
+    }
+    if (dmcIdle(dmc)) {
+        int32_t n = skipEdges(&dmc->next, dmc->stepClocks, end);
+        dmc->bitsRemaining = (uint8_t)(((dmc->bitsRemaining - 1 - n) % 8 + 8) % 8 + 1);
+        dmcNext = SKIP_FAR;
+    }
+
+    for (;;) {
+        int32_t t = triNext < noiseNext ? triNext : noiseNext;
+        if (dmcNext < t) t = dmcNext;
+        if (t >= end) break;
+
+        if (triNext == t) {
+            tri->step = (tri->step + 1) & 31;
+            tri->output = triangleSequence[tri->step];
+            triNext += tri->stepClocks;
+        }
+        if (noiseNext == t) {
+            uint16_t feedback = (noise->lfsr ^ (noise->lfsr >> (noise->shortMode ? 6 : 1))) & 1;
+            noise->lfsr = (uint16_t)((noise->lfsr >> 1) | (feedback << 14));
+            noise->output = (noise->lfsr & 1) ? 0 : noise->level;
+            noiseNext += noise->stepClocks;
+        }
+        if (dmcNext == t) {
+            stepDmc(dmc, t);
+            dmcNext += dmc->stepClocks;
+        }
+        mixTnd(apu, blip, t);
+    }
+
+    if (triNext != SKIP_FAR) tri->next = triNext;
+    if (noiseNext != SKIP_FAR) noise->next = noiseNext;
+    if (dmcNext != SKIP_FAR) dmc->next = dmcNext;
+}
+
+static void refreshNoise(ApuNoise* n) {
+    n->level = n->length == 0 ? 0 : (n->constantVolume ? n->volume : n->envelope.decay);
+    n->output = (n->lfsr & 1) ? 0 : n->level;
+}
+
+// Frame sequencer
+
+static void clockEnvelope(ApuEnvelope* env, uint8_t period, bool loop) {
+    if (env->start) {
+        env->start = false;
+        env->decay = 15;
+        env->divider = period;
+    } else if (env->divider == 0) {
+        env->divider = period;
+        if (env->decay > 0) {
+            env->decay--;
+        } else if (loop) {
+            env->decay = 15;
+        }
+    } else {
+        env->divider--;
+    }
+}
+
+static void clockSweep(ApuPulse* p) {
+    int target = sweepTarget(p);
+    if (p->sweepDivider == 0 && p->sweepEnabled && p->sweepShift > 0 && p->period >= 8 && target <= 0x7FF) {
+        p->period = (uint16_t)target;
+    }
+    if (p->sweepDivider == 0 || p->sweepReload) {
+        p->sweepDivider = p->sweepPeriod;
+        p->sweepReload = false;
+    } else {
+        p->sweepDivider--;
+    }
+}
+
+static void clockFrameUnits(Apu* apu, BlipBuffer* blip, uint8_t units) {
+    ApuTriangle* tri = &apu->triangle;
+    ApuNoise* noise = &apu->noise;
+
+    if (units & FRAME_QUARTER) {
+        for (int i = 0; i < 2; ++i) {
+            clockEnvelope(&apu->pulse[i].envelope, apu->pulse[i].volume, apu->pulse[i].halt);
+        }
+        clockEnvelope(&noise->envelope, noise->volume, noise->halt);
+
+        if (tri->linearReloadFlag) {
+            tri->linearCounter = tri->linearReload;
+        } else if (tri->linearCounter > 0) {
+            tri->linearCounter--;
+        }
+        if (!tri->control) tri->linearReloadFlag = false;
+    }
+
+    if (units & FRAME_HALF) {
+        for (int i = 0; i < 2; ++i) {
+            ApuPulse* p = &apu->pulse[i];
+            if (!p->halt && p->length > 0) p->length--;
+            clockSweep(p);
+        }
+        if (!tri->control && tri->length > 0) tri->length--;
+        if (!noise->halt && noise->length > 0) noise->length--;
+    }
+
+    if ((units & FRAME_IRQ) && !apu->frameIrqInhibit) apu->frameIrq = true;
+
+    refreshPulse(&apu->pulse[0]);
+    refreshPulse(&apu->pulse[1]);
+    refreshNoise(noise);
+    mixPulses(apu, blip, apu->time);
+    mixTnd(apu, blip, apu->time);
+}
+
+static void runApu(Apu* apu, BlipBuffer* blip, int32_t end) {
+    if (end <= apu->time) return;
+
+    while (apu->frameNext <= end) {
+        runPulses(apu, blip, apu->frameNext);
+        runTnd(apu, blip, apu->frameNext);
+        apu->time = apu->frameNext;
+
+        int mode = apu->frameMode5;
+        clockFrameUnits(apu, blip, frameStepUnits[mode][apu->frameStep]);
+        apu->frameStep = (uint8_t)((apu->frameStep + 1) % frameSteps[mode]);
+        apu->frameNext += frameStepGap[mode][apu->frameStep];
+    }
+    runPulses(apu, blip, end);
+    runTnd(apu, blip, end);
+    apu->time = end;
+}
+
+static void restartDmc(ApuDmc* d) {
+    d->address = d->sampleAddress;
+    d->bytesRemaining = d->sampleLength;
+}
+
+void initApu(Apu* apu) {
+    memset(apu, 0, sizeof(*apu));
+    apu->pulse[0].onesComplement = true;
+    for (int i = 0; i < 2; ++i) apu->pulse[i].stepClocks = 2;
+    apu->triangle.stepClocks = 1;
+    apu->noise.lfsr = 1;
+    apu->noise.stepClocks = noisePeriods[0];
+    apu->dmc.stepClocks = dmcPeriods[0];
+    apu->dmc.bitsRemaining = 8;
+    apu->dmc.silence = true;
+    apu->dmc.sampleAddress = 0xC000;
+    apu->dmc.sampleLength = 1;
+    apu->dmc.fetchTime = APU_NO_FETCH;
+    apu->frameNext = FRAME_FIRST_STEP;
+}
+
+static void writePulse(Apu* apu, int index, uint16_t addr, uint8_t value) {
+    ApuPulse* p = &apu->pulse[index];
+    switch (addr & 3) {
+        case 0:
+            p->duty = value >> 6;
+            p->halt = value & 0x20;
+            p->constantVolume = value & 0x10;
+            p->volume = value & 0x0F;
+            break;
+        case 1:
+            p->sweepEnabled = value & 0x80;
+            p->sweepPeriod = (value >> 4) & 7;
+            p->sweepNegate = value & 0x08;
+            p->sweepShift = value & 7;
+            p->sweepReload = true;
+            break;
+        case 2:
+            p->period = (uint16_t)((p->period & 0x700) | value);
+            break;
+        case 3:
+            p->period = (uint16_t)((p->period & 0xFF) | ((value & 7) << 8));
+            if (apu->enabled & (1 << index)) p->length = lengthTable[value >> 3];
+            p->step = 0;
+            p->envelope.start = true;
+            break;
+    }
+    refreshPulse(p);
+}
+
+void writeApu(Apu* apu, BlipBuffer* blip, int32_t time, uint16_t addr, uint8_t value) {
+    runApu(apu, blip, time);
+
+    ApuTriangle* tri = &apu->triangle;
+    ApuNoise* noise = &apu->noise;
+    ApuDmc* dmc = &apu->dmc;
+
+    switch (addr) {
+        case 0x4000: case 0x4001: case 0x4002: case 0x4003:
+            writePulse(apu, 0, addr, value);
+            break;
+        case 0x4004: case 0x4005: case 0x4006: case 0x4007:
+            writePulse(apu, 1, addr, value);
+            break;
+        case 0x4008:
+            tri->control = value & 0x80;
+            tri->linearReload = value & 0x7F;
+            break;
+        case 0x400A:
+            tri->period = (uint16_t)((tri->period & 0x700) | value);
+            tri->stepClocks = tri->period + 1;
+            break;
+        case 0x400B:
+            tri->period = (uint16_t)((tri->period & 0xFF) | ((value & 7) << 8));
+            tri->stepClocks = tri->period + 1;
+            if (apu->enabled & 0x04) tri->length = lengthTable[value >> 3];
+            tri->linearReloadFlag = true;
+            break;
+        case 0x400C:
+            noise->halt = value & 0x20;
+            noise->constantVolume = value & 0x10;
+            noise->volume = value & 0x0F;
+            break;
+        case 0x400E:
+            noise->shortMode = value & 0x80;
+            noise->stepClocks = noisePeriods[value & 0x0F];
+            break;
+        case 0x400F:
+            if (apu->enabled & 0x08) noise->length = lengthTable[value >> 3];
+            noise->envelope.start = true;
+            break;
+        case 0x4010:
+            dmc->irqEnabled = value & 0x80;
+            dmc->loop = value & 0x40;
+            dmc->stepClocks = dmcPeriods[value & 0x0F];
+            if (!dmc->irqEnabled) apu->dmcIrq = false;
+            break;
+        case 0x4011:
+            dmc->output = value & 0x7F;
+            break;
+        case 0x4012:
+            dmc->sampleAddress = (uint16_t)(0xC000 + value * 64);
+            break;
+        case 0x4013:
+            dmc->sampleLength = (uint16_t)(value * 16 + 1);
+            break;
+        case 0x4015:
+            apu->enabled = value & 0x1F;
+            for (int i = 0; i < 2; ++i) {
+                if (!(value & (1 << i))) apu->pulse[i].length = 0;
+                refreshPulse(&apu->pulse[i]);
+            }
+            if (!(value & 0x04)) tri->length = 0;
+            if (!(value & 0x08)) noise->length = 0;
+            apu->dmcIrq = false;
+            if (!(value & 0x10)) {
+                dmc->bytesRemaining = 0;
+            } else if (dmc->bytesRemaining == 0) {
+                restartDmc(dmc);
+                if (!dmc->bufferFull && dmc->fetchTime == APU_NO_FETCH) dmc->fetchTime = time;
+            }
+            break;
+        case 0x4017:
+            apu->frameMode5 = value & 0x80;
+            apu->frameIrqInhibit = value & 0x40;
+            if (apu->frameIrqInhibit) apu->frameIrq = false;
+            apu->frameStep = 0;
+            apu->frameNext = time + FRAME_FIRST_STEP;
+            if (apu->frameMode5) clockFrameUnits(apu, blip, FRAME_QUARTER | FRAME_HALF);
+            break;
+        default:
+            break;
+    }
+
+    refreshNoise(noise);
+    mixPulses(apu, blip, time);
+    mixTnd(apu, blip, time);
+}
+
+uint8_t readApuStatus(Apu* apu, BlipBuffer* blip, int32_t time) {
+    runApu(apu, blip, time);
+
+    uint8_t status = 0;
+    if (apu->pulse[0].length > 0) status |= 0x01;
+    if (apu->pulse[1].length > 0) status |= 0x02;
+    if (apu->triangle.length > 0) status |= 0x04;
+    if (apu->noise.length > 0) status |= 0x08;
+    if (apu->dmc.bytesRemaining > 0) status |= 0x10;
+    if (apu->frameIrq) status |= 0x40;
+    if (apu->dmcIrq) status |= 0x80;
+    apu->frameIrq = false;
+    return status;
+}
+
+void syncApu(Apu* apu, BlipBuffer* blip, int32_t time) {
+    runApu(apu, blip, time);
+}
+
+void fillApuDmc(Apu* apu, BlipBuffer* blip, int32_t time, uint8_t value) {
+    runApu(apu, blip, time);
+
+    ApuDmc* dmc = &apu->dmc;
+    dmc->fetchTime = APU_NO_FETCH;
+    if (dmc->bytesRemaining == 0) return;
+
+    dmc->buffer = value;
+    dmc->bufferFull = true;
+    dmc->address = dmc->address == 0xFFFF ? 0x8000 : dmc->address + 1;
+    if (--dmc->bytesRemaining == 0) {
+        if (dmc->loop) {
+            restartDmc(dmc);
+        } else if (dmc->irqEnabled) {
+            apu->dmcIrq = true;
+        }
+    }
+}
+
+void endApuFrame(Apu* apu, BlipBuffer* blip, int32_t clocks) {
+    runApu(apu, blip, clocks);
+    endBlipFrame(blip, (uint32_t)clocks);
+
+    apu->time -= clocks;
+    apu->frameNext -= clocks;
+    for (int i = 0; i < 2; ++i) apu->pulse[i].next -= clocks;
+    apu->triangle.next -= clocks;
+    apu->noise.next -= clocks;
+    apu->dmc.next -= clocks;
+    if (apu->dmc.fetchTime != APU_NO_FETCH) apu->dmc.fetchTime -= clocks;
+}
@@ -0,0 +1,164 @@
+#ifndef APU_H
+#define APU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "blip_buffer.h"
+
+#define APU_CLOCK_NTSC 1789773.0 // 2A03 CPU clock; every APU time is counted in it
+#define APU_NO_FETCH INT32_MAX   // ApuDmc.fetchTime when no sample byte is wanted
+
+// Envelope generator shared by the pulse and noise channels
+typedef struct {
+    bool start;
+    uint8_t divider;
+    uint8_t decay;
+} ApuEnvelope;
+
+// Channels keep their register fields decoded and cache what their sequencer
+// needs between edges: the step length in CPU clocks and, for the pulse and
+// noise channels, the level a high step outputs (already zero when muted). A
+// cache is refreshed whenever a register, the frame sequencer or a length
+// counter changes it, so advancing a channel is a walk over its edges with one
+// table lookup per step.
+typedef struct {
+    // $4000 / $4004
+    uint8_t duty;        // Duty pattern, 0-3
+    bool halt;           // Length counter halt, doubles as envelope loop
+    bool constantVolume;
+    uint8_t volume;      // Constant volume or envelope divider period
+    // $4001 / $4005
+    bool sweepEnabled;
+    bool sweepNegate;
+    uint8_t sweepPeriod;
+    uint8_t sweepShift;
+    bool sweepReload;
+    uint8_t sweepDivider;
+    // $4002-$4003 / $4006-$4007
+    uint16_t period;     // 11-bit timer reload value
+    uint8_t length;      // Length counter
+
+    ApuEnvelope envelope;
+    bool onesComplement; // Pulse 1 negates its sweep in ones' complement
+    uint8_t step;        // Duty sequencer position, 0-7
+    uint8_t level;       // Level output on a high duty step; 0 while muted
+    uint8_t output;      // Level currently output, 0-15
+    int32_t stepClocks;  // CPU clocks per sequencer step, 2 * (period + 1)
+    int32_t next;        // Time of the next sequencer step
+} ApuPulse;
+
+typedef struct {
+    bool control;          // $4008 bit 7: length halt and linear counter control
+    uint8_t linearReload;
+    uint8_t linearCounter;
+    bool linearReloadFlag;
+    uint16_t period;
+    uint8_t length;
+    uint8_t step;          // Position in the 32-step triangle sequence
+    uint8_t output;        // 0-15
+    int32_t stepClocks;    // period + 1
+    int32_t next;
+} ApuTriangle;
+
+typedef struct {
+    bool halt;
+    bool constantVolume;
+    uint8_t volume;
+    bool shortMode;        // $400E bit 7: 93-step sequence
+    uint8_t length;
+    ApuEnvelope envelope;
+    uint16_t lfsr;
+    uint8_t level;         // Envelope or constant volume; 0 while muted
+    uint8_t output;        // 0-15
+    int32_t stepClocks;
+    int32_t next;
+} ApuNoise;
+
+// Delta modulation channel. It never touches memory itself: when its sample
+// buffer empties it posts a fetch request (address and fetchTime), and the
+// owner of the CPU bus answers it with fillApuDmc.
+typedef struct {
+    bool irqEnabled;
+    bool loop;
+    uint16_t sampleAddress; // $4012: $C000 + A * 64
+    uint16_t sampleLength;  // $4013: L * 16 + 1
+    uint16_t address;       // Next byte to fetch
+    uint16_t bytesRemaining;
+    uint8_t buffer;
+    bool bufferFull;
+    uint8_t shift;
+    uint8_t bitsRemaining;  // Bits left in the current output cycle, 1-8
+    bool silence;
+    uint8_t output;         // 7-bit output level
+    int32_t stepClocks;
+    int32_t next;
+    int32_t fetchTime;      // When the pending fetch was requested, or APU_NO_FETCH
+} ApuDmc;
+
+// The APU runs lazily: nothing happens until a register access, a DMC fetch or
+// the end of a frame brings it up to the current time. Times are CPU clocks
+// from the start of the current blip buffer frame.
+//
+// Output goes through the 2A03's nonlinear mixer, implemented with its two
+// lookup tables: the pulses share one indexed by their summed levels, the
+// triangle, noise and DMC another indexed by 3 * triangle + 2 * noise + DMC.
+// The two groups add linearly, so each group is advanced in time order on its
+// own and emits a blip delta only when its table index changes.
+typedef struct {
+    ApuPulse pulse[2];
+    ApuTriangle triangle;
+    ApuNoise noise;
+    ApuDmc dmc;
+    uint8_t enabled;        // $4015 channel enable bits
+    bool frameMode5;        // $4017 bit 7: five-step sequence
+    bool frameIrqInhibit;
+    bool frameIrq;
+    bool dmcIrq;
+    uint8_t frameStep;      // Next step within the sequence
+    int32_t frameNext;      // Time of that step
+    int32_t time;           // Time the APU has been run up to
+    uint8_t pulseIndex;     // Mixer table indices currently output
+    uint8_t tndIndex;
+} Apu;
+
+void initApu(Apu* apu);
+
+// Brings the APU up to `time` and applies a CPU write to $4000-$4013, $4015 or $4017.
+void writeApu(Apu* apu, BlipBuffer* blip, int32_t time, uint16_t addr, uint8_t value);
+
+// $4015 status read: length counters, DMC activity and interrupt flags. Clears
+// the frame interrupt.
+uint8_t readApuStatus(Apu* apu, BlipBuffer* blip, int32_t time);
+
+// Delivers the byte read for the DMC's pending fetch.
+void fillApuDmc(Apu* apu, BlipBuffer* blip, int32_t time, uint8_t value);
+
+static inline bool apuIrq(const Apu* apu) {
+    return apu->frameIrq || apu->dmcIrq;
+}
+
+// Time of the DMC's next sample fetch: the pending one, or else the first time
+// a sync sees the sample buffer empty with bytes still to play (one past the
+// output step that takes the buffer). APU_NO_FETCH when none.
+static inline int32_t apuDmcFetchTime(const Apu* apu) {
+    const ApuDmc* d = &apu->dmc;
+    if (d->fetchTime != APU_NO_FETCH || !d->bufferFull || d->bytesRemaining == 0) return d->fetchTime;
+    return d->next + (d->bitsRemaining - 1) * d->stepClocks + 1;
+}
+
+// Time of the next frame sequencer step that may raise the frame interrupt,
+// INT32_MAX when none can.
+static inline int32_t apuFrameIrqTime(const Apu* apu) {
+    if (apu->frameMode5 || apu->frameIrqInhibit || apu->frameIrq) return INT32_MAX;
+    return apu->frameNext;
+}
+
+// Brings the APU up to `time` so that interrupts raised until then are visible.
+void syncApu(Apu* apu, BlipBuffer* blip, int32_t time);
+
+// Runs the APU to the end of a `clocks` long frame and ends the blip buffer
+// frame; later times are relative to the new frame.
+void endApuFrame(Apu* apu, BlipBuffer* blip, int32_t clocks);
+
+#endif
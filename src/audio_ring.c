@@ -0,0 +1,52 @@
+#include "audio_ring.h"
+
+#include <string.h>
+
+#define AUDIO_RING_MASK (AUDIO_RING_SIZE - 1)
+
+void initAudioRing(AudioRing* ring) {
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->underruns, 0);
+}
+
+// Both copies split where the ring wraps around.
+static void copyIntoRing(int16_t* data, uint32_t pos, const int16_t* src, int count) {
+    uint32_t start = pos & AUDIO_RING_MASK;
+    int first = AUDIO_RING_SIZE - (int)start;
+    if (first > count) first = count;
+    memcpy(data + start, src, first * sizeof(int16_t));
+    memcpy(data, src + first, (count - first) * sizeof(int16_t));
+}
+
+static void copyFromRing(const int16_t* data, uint32_t pos, int16_t* dst, int count) {
+    uint32_t start = pos & AUDIO_RING_MASK;
+    int first = AUDIO_RING_SIZE - (int)start;
+    if (first > count) first = count;
+    memcpy(dst, data + start, first * sizeof(int16_t));
+    memcpy(dst + first, data, (count - first) * sizeof(int16_t));
+}
+
+int writeAudioRing(AudioRing* ring, const int16_t* samples, int count) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    int space = AUDIO_RING_SIZE - (int)(head - tail);
+    if (count > space) count = space;
+
+    copyIntoRing(ring->data, head, samples, count);
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+int readAudioRing(AudioRing* ring, int16_t* out, int count) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    int avail = (int)(head - tail);
+    if (count > avail) count = avail;
+
+    copyFromRing(ring->data, tail, out, count);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
@@ -0,0 +1,36 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define AUDIO_RING_SIZE 8192 // Samples; must be a power of two
+#define CACHE_LINE 64
+
+// Lock-free single-producer/single-consumer sample queue between the emulation
+// thread and the SDL audio callback. Each index is written by one side only and
+// lives on its own cache line; the indices run freely and are masked on access,
+// so full and empty are told apart without a spare slot.
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic uint32_t head; // Next write position (producer)
+    _Alignas(CACHE_LINE) _Atomic uint32_t tail; // Next read position (consumer)
+    _Atomic uint32_t underruns;                 // Callbacks the ring could not satisfy
+    _Alignas(CACHE_LINE) int16_t data[AUDIO_RING_SIZE];
+} AudioRing;
+
+void initAudioRing(AudioRing* ring);
+
+// Producer side. Copies as many samples as fit and returns that count; the rest
+// are dropped.
+int writeAudioRing(AudioRing* ring, const int16_t* samples, int count);
+
+// Consumer side. Copies up to `count` samples and returns the number copied.
+int readAudioRing(AudioRing* ring, int16_t* out, int count);
+
+// Samples currently queued. Exact on either side's own thread, a snapshot elsewhere.
+static inline int audioRingFill(AudioRing* ring) {
+    return (int)(atomic_load_explicit(&ring->head, memory_order_acquire) -
+                 atomic_load_explicit(&ring->tail, memory_order_acquire));
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef BLIP_BUFFER_H
+#define BLIP_BUFFER_H
+
+#include <stdint.h>
+
+#define BLIP_PHASE_BITS 5
+#define BLIP_PHASES (1 << BLIP_PHASE_BITS) // Sub-sample positions of a step
+#define BLIP_TAPS 16                         // Kernel width in output samples
+#define BLIP_KERNEL_BITS 15                  // Each kernel phase sums to 1 << 15
+#define BLIP_MAX_SAMPLES 4096                // Output samples one frame may produce
+#define BLIP_TIME_BITS 32                    // Fraction bits of a sample position
+
+// Band-limited step synthesis. Sound sources do not produce samples; they
+// report each change of their output level as a delta at the clock it
+// happened. The delta is spread over BLIP_TAPS samples with a windowed-sinc
+// kernel picked by its fractional position, and reading integrates the deltas
+// back into a waveform. Work is proportional to the number of transitions, not
+// to the clock rate, so sources can run at the native APU clock while output is
+// resampled once per frame.
+typedef struct {
+    uint64_t factor;    // Output samples per input clock, 32.32 fixed point
+    uint64_t offset;    // Position of the current frame start relative to buf[0]
+    int32_t integrator; // Running sum of deltas, scaled by 1 << BLIP_KERNEL_BITS
+    int32_t buf[BLIP_MAX_SAMPLES + BLIP_TAPS];
+} BlipBuffer;
+
+void initBlipBuffer(BlipBuffer* blip, double clockRate, double sampleRate);
+
+// Changes the resampling ratio without disturbing buffered samples.
+void setBlipRates(BlipBuffer* blip, double clockRate, double sampleRate);
+
+// Adds an amplitude change at `time` clocks after the start of the current frame.
+static inline void addBlipDelta(BlipBuffer* blip, uint32_t time, int delta) {
+    extern const int16_t blipKernel[BLIP_PHASES][BLIP_TAPS];
+
+    uint64_t pos = blip->offset + (uint64_t)time * blip->factor;
+    int32_t* out = &blip->buf[pos >> BLIP_TIME_BITS];
+    const int16_t* kernel = blipKernel[(pos >> (BLIP_TIME_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1)];
+    for (int i = 0; i < BLIP_TAPS; ++i) {
+        out[i] += kernel[i] * delta;
+    }
+}
+
+// Ends the current frame after `clocks` input clocks; its samples become readable.
+void endBlipFrame(BlipBuffer* blip, uint32_t clocks);
+
+// Input clocks the next frame needs for `samples` samples to be readable in total.
+uint32_t blipClocksNeeded(const BlipBuffer* blip, int samples);
+
+static inline int blipSamplesAvail(const BlipBuffer* blip) {
+    return (int)(blip->offset >> BLIP_TIME_BITS);
+}
+
+// Integrates up to `count` samples into `out` and removes them from the buffer.
+// Returns the number of samples written.
+int readBlipSamples(BlipBuffer* blip, int16_t* out, int count);
+
+#endif
@@ -0,0 +1,38 @@
+#include "bus.h"
+
+void initBus(Bus* bus, void* ctx, BusReadFn read, BusWriteFn write) {
+    bus->ctx = ctx;
+    bus->openBus = 0;
+    clearBusDirty(bus);
+    mapBusHandlers(bus, 0, 0x10000, read, write);
+}
+
+void clearBusDirty(Bus* bus) {
+    for (size_t i = 0; i < sizeof(bus->dirty) / sizeof(bus->dirty[0]); ++i) bus->dirty[i] = 0;
+}
+
+void mapBusRam(Bus* bus, uint16_t addr, size_t size, uint8_t* mem) {
+    unsigned first = addr >> BUS_PAGE_BITS;
+    for (unsigned i = 0; i < size >> BUS_PAGE_BITS; ++i) {
+        bus->read[first + i] = mem + i * BUS_PAGE_SIZE;
+        bus->write[first + i] = mem + i * BUS_PAGE_SIZE;
+    }
+}
+
+void mapBusRom(Bus* bus, uint16_t addr, size_t size, const uint8_t* mem) {
+    unsigned first = addr >> BUS_PAGE_BITS;
+    for (unsigned i = 0; i < size >> BUS_PAGE_BITS; ++i) {
+        bus->read[first + i] = mem + i * BUS_PAGE_SIZE;
+        bus->write[first + i] = NULL;
+    }
+}
+
+void mapBusHandlers(Bus* bus, uint16_t addr, size_t size, BusReadFn read, BusWriteFn write) {
+    unsigned first = addr >> BUS_PAGE_BITS;
+    for (unsigned i = 0; i < size >> BUS_PAGE_BITS; ++i) {
+        bus->read[first + i] = NULL;
+        bus->write[first + i] = NULL;
+        bus->readHandler[first + i] = read;
+        bus->writeHandler[first + i] = write;
+    }
+}
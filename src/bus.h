@@ -0,0 +1,70 @@
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUS_PAGE_BITS 10
+#define BUS_PAGE_SIZE (1 << BUS_PAGE_BITS)    // 1 KB
+#define BUS_PAGES (0x10000 >> BUS_PAGE_BITS)  // 64
+#define BUS_DIRTY_BITS 8                      // Writes are tracked per 256-byte page
+
+typedef uint8_t (*BusReadFn)(void* ctx, uint16_t addr);
+typedef void (*BusWriteFn)(void* ctx, uint16_t addr, uint8_t value);
+
+// CPU address space as a table of 1 KB pages. A page is backed either by host
+// memory, which the CPU reads or writes directly, or by a handler for memory
+// mapped I/O. Reads and writes look up their page's pointer and only fall back
+// to the handler when it is NULL, so RAM and ROM accesses never decode address
+// ranges. ROM pages have a read pointer and a write handler (mapper
+// registers); a bank switch just points pages somewhere else.
+//
+// Direct writes also set a dirty bit for their 256-byte page, so savestates
+// can copy only the memory that changed since the last one.
+typedef struct {
+    const uint8_t* read[BUS_PAGES];
+    uint8_t* write[BUS_PAGES];
+    BusReadFn readHandler[BUS_PAGES];
+    BusWriteFn writeHandler[BUS_PAGES];
+    void* ctx;                       // Passed to every handler
+    uint8_t openBus;                 // Last value on the data bus
+    uint64_t dirty[0x10000 >> BUS_DIRTY_BITS >> 6]; // Pages written since cleared, bit per page
+} Bus;
+
+// Starts with every page on the given handlers.
+void initBus(Bus* bus, void* ctx, BusReadFn read, BusWriteFn write);
+
+// Backs `size` bytes from `addr` with host memory, one page after another.
+// Both must be multiples of BUS_PAGE_SIZE; map the same memory again to mirror it.
+void mapBusRam(Bus* bus, uint16_t addr, size_t size, uint8_t* mem);
+
+// Read-only memory: reads are direct, writes still go to the page's handler.
+void mapBusRom(Bus* bus, uint16_t addr, size_t size, const uint8_t* mem);
+
+// Hands pages back to handlers for both reads and writes.
+void mapBusHandlers(Bus* bus, uint16_t addr, size_t size, BusReadFn read, BusWriteFn write);
+
+void clearBusDirty(Bus* bus);
+
+static inline uint8_t readBus(Bus* bus, uint16_t addr) {
+    unsigned page = addr >> BUS_PAGE_BITS;
+    const uint8_t* mem = bus->read[page];
+    uint8_t value = mem ? mem[addr & (BUS_PAGE_SIZE - 1)] : bus->readHandler[page](bus->ctx, addr);
+    bus->openBus = value;
+    return value;
+}
+
+static inline void writeBus(Bus* bus, uint16_t addr, uint8_t value) {
+    unsigned page = addr >> BUS_PAGE_BITS;
+    uint8_t* mem = bus->write[page];
+    bus->openBus = value;
+    if (mem) {
+        mem[addr & (BUS_PAGE_SIZE - 1)] = value;
+        bus->dirty[addr >> 14] |= 1ull << ((addr >> BUS_DIRTY_BITS) & 63);
+    } else {
+        bus->writeHandler[page](bus->ctx, addr, value);
+    }
+}
+
+#endif
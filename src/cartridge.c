@@ -0,0 +1,127 @@
+#include "cartridge.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HEADER_SIZE 16
+#define TRAINER_SIZE 512
+#define DEFAULT_PRG_RAM 0x2000 // iNES 1.0 headers cannot say; most boards that have any have 8 KB
+
+// NES 2.0 ROM size: a count of units, or 2^E * (M * 2 + 1) bytes when the
+// most significant nibble is $F
+static size_t romSize(uint8_t lsb, uint8_t msb, size_t unit) {
+    if (msb == 0xF) {
+        unsigned exponent = lsb >> 2;
+        if (exponent > 30) return SIZE_MAX;
+        return ((size_t)1 << exponent) * ((lsb & 3) * 2 + 1);
+    }
+    return ((size_t)msb << 8 | lsb) * unit;
+}
+
+// NES 2.0 RAM size: 64 << shift bytes, none for 0
+static size_t ramSize(uint8_t shift) {
+    return shift ? (size_t)64 << shift : 0;
+}
+
+static bool parseHeader(Cartridge* cart, const char** error) {
+    const uint8_t* h = cart->image;
+    if (cart->imageSize < HEADER_SIZE || memcmp(h, "NES\x1A", 4) != 0) {
+        *error = "not an iNES or NES 2.0 image";
+        return false;
+    }
+
+    cart->nes2 = (h[7] & 0x0C) == 0x08;
+    cart->battery = (h[6] & 0x02) != 0;
+    cart->mirroring = h[6] & 0x08 ? MIRROR_FOUR_SCREEN : h[6] & 0x01 ? MIRROR_VERTICAL : MIRROR_HORIZONTAL;
+    cart->mapper = h[6] >> 4;
+
+    if (cart->nes2) {
+        cart->mapper |= (uint16_t)((h[7] & 0xF0) | (h[8] & 0x0F) << 8);
+        cart->submapper = h[8] >> 4;
+        cart->prgSize = romSize(h[4], h[9] & 0x0F, PRG_BANK_SIZE);
+        cart->chrSize = romSize(h[5], h[9] >> 4, CHR_BANK_SIZE);
+        cart->prgRamSize = ramSize(h[10] & 0x0F) + ramSize(h[10] >> 4);
+        cart->chrRamSize = ramSize(h[11] & 0x0F) + ramSize(h[11] >> 4);
+    } else {
+        // Old dumpers wrote their name over bytes 7-15; the upper mapper
+        // nibble is only trusted when the padding is clean
+        static const uint8_t zeros[5];
+        if (memcmp(h + 11, zeros, sizeof(zeros)) == 0) cart->mapper |= h[7] & 0xF0;
+        cart->submapper = 0;
+        cart->prgSize = (size_t)h[4] * PRG_BANK_SIZE;
+        cart->chrSize = (size_t)h[5] * CHR_BANK_SIZE;
+        cart->prgRamSize = DEFAULT_PRG_RAM;
+        cart->chrRamSize = cart->chrSize ? 0 : CHR_BANK_SIZE;
+    }
+
+    // PRG banks are 8 KB at the finest, and boards switch PRG in windows of up
+    // to 16 KB and CHR in windows of up to 8 KB, which must hold at least one
+    // bank. NES 2.0 can encode smaller sizes; no supported board has them.
+    if (cart->prgSize < PRG_BANK_SIZE || cart->prgSize % 0x2000 != 0 || cart->chrSize % CHR_BANK_SIZE != 0) {
+        *error = "unsupported PRG or CHR size";
+        return false;
+    }
+
+    size_t offset = HEADER_SIZE + (h[6] & 0x04 ? TRAINER_SIZE : 0);
+    if (offset > cart->imageSize || cart->prgSize > cart->imageSize - offset ||
+        cart->chrSize > cart->imageSize - offset - cart->prgSize) {
+        *error = "file is shorter than its header says";
+        return false;
+    }
+    cart->prg = cart->image + offset;
+    cart->chr = cart->chrSize ? cart->prg + cart->prgSize : NULL;
+    return true;
+}
+
+bool loadCartridge(Cartridge* cart, const char* path, const char** error) {
+    memset(cart, 0, sizeof(*cart));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        *error = "cannot open the file";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+        close(fd);
+        *error = "not an iNES or NES 2.0 image";
+        return false;
+    }
+    void* image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        *error = "cannot map the file";
+        return false;
+    }
+    cart->image = image;
+    cart->imageSize = (size_t)st.st_size;
+
+    if (!parseHeader(cart, error)) {
+        unloadCartridge(cart);
+        return false;
+    }
+
+    if (cart->chr) {
+        size_t pages = cart->chrSize / PPU_CHR_PAGE_SIZE;
+        cart->chrCache = malloc(sizeof(TileCache) * pages);
+        if (!cart->chrCache) {
+            unloadCartridge(cart);
+            *error = "out of memory";
+            return false;
+        }
+        for (size_t i = 0; i < pages; ++i) {
+            initTileCache(&cart->chrCache[i], cart->chr + i * PPU_CHR_PAGE_SIZE, true);
+        }
+    }
+    return true;
+}
+
+void unloadCartridge(Cartridge* cart) {
+    if (cart->image) munmap((void*)cart->image, cart->imageSize);
+    free(cart->chrCache);
+    memset(cart, 0, sizeof(*cart));
+}
@@ -0,0 +1,49 @@
+#ifndef CARTRIDGE_H
+#define CARTRIDGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ppu.h"
+
+#define PRG_BANK_SIZE 0x4000 // iNES PRG-ROM unit
+#define CHR_BANK_SIZE 0x2000 // iNES CHR-ROM unit
+
+typedef enum {
+    MIRROR_HORIZONTAL, // $2000/$2400 share a nametable, as do $2800/$2C00
+    MIRROR_VERTICAL,   // $2000/$2800 share one, as do $2400/$2C00
+    MIRROR_FOUR_SCREEN,
+    MIRROR_SINGLE_LOW,  // All four show the first nametable; set by mappers only
+    MIRROR_SINGLE_HIGH
+} Mirroring;
+
+// A ROM image in iNES or NES 2.0 format. The file is mapped read-only and PRG
+// and CHR point straight into the mapping, so loading copies and parses
+// nothing but the header, and sessions (or processes) running the same game
+// share the same physical pages. CHR-ROM is decoded into tile caches once,
+// at load, and those are shared by every session the cartridge is inserted
+// into as well. A cartridge is never written to and must outlive them all.
+typedef struct {
+    const uint8_t* image;  // The whole mapped file
+    size_t imageSize;
+    const uint8_t* prg;
+    size_t prgSize;
+    const uint8_t* chr;    // NULL when the board has CHR-RAM
+    size_t chrSize;
+    TileCache* chrCache;   // One per 1 KB of CHR-ROM
+    uint16_t mapper;
+    uint8_t submapper;
+    Mirroring mirroring;
+    bool battery;          // PRG-RAM is meant to be kept between runs
+    size_t prgRamSize;
+    size_t chrRamSize;
+    bool nes2;             // Header is NES 2.0
+} Cartridge;
+
+// Maps and validates the ROM at `path`. On failure returns false and points
+// `error` at a description.
+bool loadCartridge(Cartridge* cart, const char* path, const char** error);
+void unloadCartridge(Cartridge* cart);
+
+#endif
@@ -0,0 +1,154 @@
+#include "compose.h"
+
+#include "ppu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COMPOSE_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define COMPOSE_NEON
+#endif
+
+// A sprite pixel shows when it is opaque and either in front or over a
+// transparent background pixel.
+static inline uint8_t composePixel(uint8_t bg, uint8_t sprite) {
+    return sprite && (!bg || !(sprite & SPRITE_BEHIND)) ? sprite & SPRITE_COLOR : bg;
+}
+
+static void composeScalar(uint32_t* out, const uint8_t* bg, const uint8_t* sprites, int count,
+                          const uint32_t* palette) {
+    for (int i = 0; i < count; ++i) out[i] = palette[composePixel(bg[i], sprites[i])];
+}
+
+#ifdef COMPOSE_X86
+
+// SSE2 has no table lookup instruction, so the indices are merged 16 at a
+// time and then resolved with scalar loads.
+__attribute__((target("sse2")))
+static void composeSse2(uint32_t* out, const uint8_t* bg, const uint8_t* sprites, int count,
+                        const uint32_t* palette) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i behind = _mm_set1_epi8(SPRITE_BEHIND);
+    const __m128i color = _mm_set1_epi8(SPRITE_COLOR);
+    uint8_t index[16];
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(bg + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(sprites + i));
+        __m128i spriteClear = _mm_cmpeq_epi8(s, zero);
+        __m128i bgClear = _mm_cmpeq_epi8(b, zero);
+        __m128i front = _mm_cmpeq_epi8(_mm_and_si128(s, behind), zero);
+        __m128i useSprite = _mm_andnot_si128(spriteClear, _mm_or_si128(bgClear, front));
+        __m128i merged = _mm_or_si128(_mm_and_si128(useSprite, _mm_and_si128(s, color)),
+                                      _mm_andnot_si128(useSprite, b));
+        _mm_storeu_si128((__m128i*)index, merged);
+        for (int j = 0; j < 16; ++j) out[i + j] = palette[index[j]];
+    }
+    composeScalar(out + i, bg + i, sprites + i, count - i, palette);
+}
+
+// Resolves eight indices (0-31) against the palette held in four registers:
+// each permute picks within eight entries, then bits 3 and 4 choose between them.
+__attribute__((target("avx2")))
+static inline __m256i lookupAvx2(__m256i index, __m256i p0, __m256i p1, __m256i p2, __m256i p3) {
+    __m256 bit3 = _mm256_castsi256_ps(_mm256_slli_epi32(index, 28));
+    __m256 bit4 = _mm256_castsi256_ps(_mm256_slli_epi32(index, 27));
+    __m256 low = _mm256_blendv_ps(_mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p0, index)),
+                                  _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p1, index)), bit3);
+    __m256 high = _mm256_blendv_ps(_mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p2, index)),
+                                   _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p3, index)), bit3);
+    return _mm256_castps_si256(_mm256_blendv_ps(low, high, bit4));
+}
+
+__attribute__((target("avx2")))
+static void composeAvx2(uint32_t* out, const uint8_t* bg, const uint8_t* sprites, int count,
+                        const uint32_t* palette) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i behind = _mm256_set1_epi8(SPRITE_BEHIND);
+    const __m256i color = _mm256_set1_epi8(SPRITE_COLOR);
+    const __m256i p0 = _mm256_loadu_si256((const __m256i*)(palette + 0));
+    const __m256i p1 = _mm256_loadu_si256((const __m256i*)(palette + 8));
+    const __m256i p2 = _mm256_loadu_si256((const __m256i*)(palette + 16));
+    const __m256i p3 = _mm256_loadu_si256((const __m256i*)(palette + 24));
+    int i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i*)(bg + i));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(sprites + i));
+        __m256i spriteClear = _mm256_cmpeq_epi8(s, zero);
+        __m256i bgClear = _mm256_cmpeq_epi8(b, zero);
+        __m256i front = _mm256_cmpeq_epi8(_mm256_and_si256(s, behind), zero);
+        __m256i useSprite = _mm256_andnot_si256(spriteClear, _mm256_or_si256(bgClear, front));
+        __m256i merged = _mm256_blendv_epi8(b, _mm256_and_si256(s, color), useSprite);
+
+        __m128i low = _mm256_castsi256_si128(merged);
+        __m128i high = _mm256_extracti128_si256(merged, 1);
+        __m256i* dst = (__m256i*)(out + i);
+        _mm256_storeu_si256(dst + 0, lookupAvx2(_mm256_cvtepu8_epi32(low), p0, p1, p2, p3));
+        _mm256_storeu_si256(dst + 1, lookupAvx2(_mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)), p0, p1, p2, p3));
+        _mm256_storeu_si256(dst + 2, lookupAvx2(_mm256_cvtepu8_epi32(high), p0, p1, p2, p3));
+        _mm256_storeu_si256(dst + 3, lookupAvx2(_mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)), p0, p1, p2, p3));
+    }
+    composeSse2(out + i, bg + i, sprites + i, count - i, palette);
+}
+
+#endif
+
+#ifdef COMPOSE_NEON
+
+// The palette is split into byte planes so that one two-register table
+// lookup per plane resolves 16 pixels, and an interleaving store writes them
+// back out as ARGB8888.
+static void composeNeon(uint32_t* out, const uint8_t* bg, const uint8_t* sprites, int count,
+                        const uint32_t* palette) {
+    uint8x16x4_t first = vld4q_u8((const uint8_t*)palette);
+    uint8x16x4_t second = vld4q_u8((const uint8_t*)(palette + 16));
+    uint8x16x2_t planes[4];
+    for (int c = 0; c < 4; ++c) {
+        planes[c].val[0] = first.val[c];
+        planes[c].val[1] = second.val[c];
+    }
+    const uint8x16_t behind = vdupq_n_u8(SPRITE_BEHIND);
+    const uint8x16_t color = vdupq_n_u8(SPRITE_COLOR);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t b = vld1q_u8(bg + i);
+        uint8x16_t s = vld1q_u8(sprites + i);
+        uint8x16_t spriteOpaque = vtstq_u8(s, s);
+        uint8x16_t bgClear = vceqzq_u8(b);
+        uint8x16_t front = vceqzq_u8(vandq_u8(s, behind));
+        uint8x16_t useSprite = vandq_u8(spriteOpaque, vorrq_u8(bgClear, front));
+        uint8x16_t index = vbslq_u8(useSprite, vandq_u8(s, color), b);
+
+        uint8x16x4_t argb;
+        for (int c = 0; c < 4; ++c) argb.val[c] = vqtbl2q_u8(planes[c], index);
+        vst4q_u8((uint8_t*)(out + i), argb);
+    }
+    composeScalar(out + i, bg + i, sprites + i, count - i, palette);
+}
+
+#endif
+
+ComposeFn selectCompose(const char** name) {
+    const char* label = "scalar";
+    ComposeFn fn = composeScalar;
+#if defined(COMPOSE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        label = "AVX2";
+        fn = composeAvx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        label = "SSE2";
+        fn = composeSse2;
+    }
+#elif defined(COMPOSE_NEON)
+    // NEON is part of the AArch64 base architecture
+    label = "NEON";
+    fn = composeNeon;
+#endif
+    if (name) *name = label;
+    return fn;
+}
@@ -0,0 +1,17 @@
+#ifndef COMPOSE_H
+#define COMPOSE_H
+
+#include <stdint.h>
+
+// Merges a span of background palette indices (0 where transparent) with the
+// matching span of the sprite line buffer and writes the resulting colours,
+// looked up in `palette` (32 ARGB8888 entries), to `out`.
+typedef void (*ComposeFn)(uint32_t* out, const uint8_t* bg, const uint8_t* sprites, int count,
+                          const uint32_t* palette);
+
+// Picks the fastest implementation the host CPU supports: AVX2 (32 pixels
+// per step) or SSE2 (16) on x86, NEON (16) on AArch64, plain C elsewhere.
+// `name`, if not NULL, receives a label for the choice.
+ComposeFn selectCompose(const char** name);
+
+#endif
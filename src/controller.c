@@ -0,0 +1,27 @@
+#include "controller.h"
+
+#include <string.h>
+
+#define OPEN_BUS_MASK 0xE0
+
+void initControllerPorts(ControllerPorts* ports) {
+    memset(ports, 0, sizeof(*ports));
+}
+
+void writeControllerStrobe(ControllerPorts* ports, uint8_t value, const uint8_t input[INPUT_PORTS]) {
+    bool strobe = value & 1;
+    // The shift registers load on the high level and hold once it drops, so
+    // the falling edge is the moment the buttons are sampled.
+    if (ports->strobe || strobe) {
+        for (int i = 0; i < INPUT_PORTS; ++i) ports->shift[i] = input[i];
+    }
+    ports->strobe = strobe;
+}
+
+uint8_t readControllerPort(ControllerPorts* ports, int port, const uint8_t input[INPUT_PORTS], uint8_t openBus) {
+    if (ports->strobe) ports->shift[port] = input[port];
+
+    uint8_t bit = ports->shift[port] & 1;
+    if (!ports->strobe) ports->shift[port] = (uint8_t)((ports->shift[port] >> 1) | 0x80);
+    return (uint8_t)((openBus & OPEN_BUS_MASK) | bit);
+}
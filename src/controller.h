@@ -0,0 +1,31 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "input.h"
+
+// Standard controllers behind $4016/$4017. Writing 1 then 0 to bit 0 of $4016
+// latches both pads' buttons into 8-bit shift registers; each read returns the
+// next bit in D0, A first, and official pads return 1 after the eighth read.
+// While the strobe is held high the register keeps reloading, so reads return
+// the live A button. D1-D4 (expansion port) read 0 and D5-D7 are open bus.
+//
+// Buttons are taken from `input` (one byte per port, as Input keeps them) at
+// the moment of the latch rather than at the start of the host frame.
+typedef struct {
+    bool strobe;
+    uint8_t shift[INPUT_PORTS];
+} ControllerPorts;
+
+void initControllerPorts(ControllerPorts* ports);
+
+// CPU write to $4016.
+void writeControllerStrobe(ControllerPorts* ports, uint8_t value, const uint8_t input[INPUT_PORTS]);
+
+// CPU read from $4016 (port 0) or $4017 (port 1). `openBus` is the value last
+// seen on the data bus, which supplies the undriven upper bits.
+uint8_t readControllerPort(ControllerPorts* ports, int port, const uint8_t input[INPUT_PORTS], uint8_t openBus);
+
+#endif
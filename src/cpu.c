@@ -0,0 +1,509 @@
+#include "cpu.h"
+
+#if !defined(__GNUC__)
+#error "The CPU core dispatches with computed goto (GCC/Clang labels as values)"
+#endif
+
+#define FLAG_C 0x01
+#define FLAG_Z 0x02
+#define FLAG_I 0x04
+#define FLAG_D 0x08
+#define FLAG_B 0x10
+#define FLAG_U 0x20
+#define FLAG_V 0x40
+#define FLAG_N 0x80
+
+#define VECTOR_NMI   0xFFFA
+#define VECTOR_RESET 0xFFFC
+#define VECTOR_IRQ   0xFFFE
+
+#define INTERRUPT_CYCLES 7
+
+// Base cycles per opcode; page-crossing and branch penalties are added as
+// the instruction executes.
+static const uint8_t cycleTable[256] = {
+    7, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6,
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6,
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+    6, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6,
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6,
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+    2, 6, 2, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5,
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+    2, 5, 2, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4,
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+};
+
+void initCpu(Cpu* cpu, Bus* bus) {
+    cpu->pc = 0;
+    cpu->a = cpu->x = cpu->y = 0;
+    cpu->s = 0xFD;
+    cpu->p = FLAG_U | FLAG_I | FLAG_B;
+    cpu->nmi = false;
+    cpu->irq = 0;
+    cpu->jammed = false;
+    cpu->cycles = 0;
+    cpu->deadline = 0;
+    cpu->bus = bus;
+}
+
+void resetCpu(Cpu* cpu) {
+    cpu->s -= 3;
+    cpu->p |= FLAG_I;
+    cpu->nmi = false;
+    cpu->jammed = false;
+    cpu->pc = (uint16_t)(readBus(cpu->bus, VECTOR_RESET) | (readBus(cpu->bus, VECTOR_RESET + 1) << 8));
+    cpu->cycles += INTERRUPT_CYCLES;
+}
+
+// Memory access goes through the bus page table: RAM and ROM are read inline,
+// I/O handlers see cpu->cycles already advanced by the whole instruction.
+#define READ(addr) readBus(bus, (uint16_t)(addr))
+#define WRITE(addr, v) writeBus(bus, (uint16_t)(addr), (uint8_t)(v))
+#define FETCH8() READ(pc++)
+#define FETCH16() ({ uint16_t lo_ = FETCH8(); (uint16_t)(lo_ | (FETCH8() << 8)); })
+#define READ16(addr) ({ uint16_t lo_ = READ(addr); (uint16_t)(lo_ | (READ((addr) + 1) << 8)); })
+#define PUSH(v) WRITE(0x100 | s--, (v))
+#define PULL() READ(0x100 | ++s)
+
+// Flags are kept unpacked while running. N and Z are evaluated lazily from the
+// last result; they live apart because BIT sets them from different values.
+#define SET_NZ(v) (resultN = resultZ = (uint8_t)(v))
+#define PACK_FLAGS() ((uint8_t)((resultN & FLAG_N) | (flagV << 6) | FLAG_U | (flagD << 3) | \
+                                (flagI << 2) | ((resultZ == 0) << 1) | flagC))
+#define UNPACK_FLAGS(v) do {              \
+        uint8_t p_ = (v);                 \
+        flagC = p_ & FLAG_C;              \
+        resultZ = !(p_ & FLAG_Z);         \
+        flagI = (p_ >> 2) & 1;            \
+        flagD = (p_ >> 3) & 1;            \
+        flagV = (p_ >> 6) & 1;            \
+        resultN = p_ & FLAG_N;            \
+    } while (0)
+
+// Addressing modes. The _READ variants charge the extra cycle of a page
+// crossing; stores and read-modify-writes always pay it in their base cost.
+#define PAGE_PENALTY(base, addr) (cpu->cycles += (((base) ^ (addr)) & 0xFF00) != 0)
+#define ADDR_IMM() (addr = pc++)
+#define ADDR_ZP() (addr = FETCH8())
+#define ADDR_ZPX() (addr = (uint8_t)(FETCH8() + x))
+#define ADDR_ZPY() (addr = (uint8_t)(FETCH8() + y))
+#define ADDR_ABS() (addr = FETCH16())
+#define ADDR_ABX() (addr = (uint16_t)(FETCH16() + x))
+#define ADDR_ABY() (addr = (uint16_t)(FETCH16() + y))
+#define ADDR_ABX_READ() do { uint16_t base_ = FETCH16(); addr = (uint16_t)(base_ + x); PAGE_PENALTY(base_, addr); } while (0)
+#define ADDR_ABY_READ() do { uint16_t base_ = FETCH16(); addr = (uint16_t)(base_ + y); PAGE_PENALTY(base_, addr); } while (0)
+#define ADDR_IZX() do {                                                          \
+        uint8_t ptr_ = (uint8_t)(FETCH8() + x);                                  \
+        addr = (uint16_t)(READ(ptr_) | (READ((uint8_t)(ptr_ + 1)) << 8));        \
+    } while (0)
+#define ZP_POINTER() ({ uint8_t ptr_ = FETCH8(); (uint16_t)(READ(ptr_) | (READ((uint8_t)(ptr_ + 1)) << 8)); })
+#define ADDR_IZY() (addr = (uint16_t)(ZP_POINTER() + y))
+#define ADDR_IZY_READ() do { uint16_t base_ = ZP_POINTER(); addr = (uint16_t)(base_ + y); PAGE_PENALTY(base_, addr); } while (0)
+
+// Operations
+#define ADC(v) do {                                                    \
+        uint8_t m_ = (v);                                              \
+        unsigned sum_ = a + m_ + flagC;                                \
+        flagV = ((~(a ^ m_) & (a ^ sum_)) >> 7) & 1;                   \
+        flagC = sum_ > 0xFF;                                           \
+        a = (uint8_t)sum_;                                             \
+        SET_NZ(a);                                                     \
+    } while (0)
+#define COMPARE(r, v) do { uint8_t m_ = (v); flagC = (r) >= m_; SET_NZ((r) - m_); } while (0)
+#define BIT(v) do { uint8_t m_ = (v); resultZ = a & m_; resultN = m_; flagV = (m_ >> 6) & 1; } while (0)
+#define ASL(v) ({ uint8_t m_ = (v); flagC = m_ >> 7; m_ = (uint8_t)(m_ << 1); SET_NZ(m_); m_; })
+#define LSR(v) ({ uint8_t m_ = (v); flagC = m_ & 1; m_ >>= 1; SET_NZ(m_); m_; })
+#define ROL(v) ({ uint8_t m_ = (v); uint8_t c_ = flagC; flagC = m_ >> 7; m_ = (uint8_t)((m_ << 1) | c_); SET_NZ(m_); m_; })
+#define ROR(v) ({ uint8_t m_ = (v); uint8_t c_ = flagC; flagC = m_ & 1; m_ = (uint8_t)((m_ >> 1) | (c_ << 7)); SET_NZ(m_); m_; })
+#define ARR(v) do {                                                    \
+        a = (uint8_t)(((a & (v)) >> 1) | (flagC << 7));                \
+        SET_NZ(a);                                                     \
+        flagC = (a >> 6) & 1;                                          \
+        flagV = ((a >> 6) ^ (a >> 5)) & 1;                             \
+    } while (0)
+#define AXS(v) do { uint8_t m_ = (v); uint8_t ax_ = a & x; flagC = ax_ >= m_; x = (uint8_t)(ax_ - m_); SET_NZ(x); } while (0)
+
+#define BRANCH(cond) do {                                              \
+        int8_t offset_ = (int8_t)FETCH8();                             \
+        if (cond) {                                                    \
+            uint16_t dest_ = (uint16_t)(pc + offset_);                 \
+            cpu->cycles += 1 + (((pc ^ dest_) & 0xFF00) != 0);         \
+            pc = dest_;                                                \
+        }                                                              \
+    } while (0)
+#define JSR() do {                                                     \
+        uint16_t target_ = FETCH16();                                  \
+        pc--;                                                          \
+        PUSH(pc >> 8);                                                 \
+        PUSH(pc & 0xFF);                                               \
+        pc = target_;                                                  \
+    } while (0)
+#define RTS() do { uint16_t lo_ = PULL(); pc = (uint16_t)((lo_ | (PULL() << 8)) + 1); } while (0)
+#define RTI() do { UNPACK_FLAGS(PULL()); uint16_t lo_ = PULL(); pc = (uint16_t)(lo_ | (PULL() << 8)); } while (0)
+#define PLP() UNPACK_FLAGS(PULL())
+#define BRK() do {                                                     \
+        pc++;                                                          \
+        PUSH(pc >> 8);                                                 \
+        PUSH(pc & 0xFF);                                               \
+        PUSH(PACK_FLAGS() | FLAG_B);                                   \
+        flagI = 1;                                                     \
+        pc = READ16(VECTOR_IRQ);                                       \
+    } while (0)
+// The 6502 reads the high byte of an indirect JMP without carrying into the page
+#define JMP_INDIRECT() do {                                            \
+        uint16_t ptr_ = FETCH16();                                     \
+        uint16_t lo_ = READ(ptr_);                                     \
+        pc = (uint16_t)(lo_ | (READ((ptr_ & 0xFF00) | ((ptr_ + 1) & 0xFF)) << 8)); \
+    } while (0)
+#define KIL() do { cpu->jammed = true; pc--; goto done; } while (0)
+
+// Dispatch: check for the deadline and pending interrupts, then jump straight
+// to the next opcode's handler.
+#define NEXT() do {                                                    \
+        if (cpu->cycles >= cpu->deadline) goto done;                   \
+        if (cpu->nmi || (cpu->irq && !flagI)) goto interrupt;          \
+        opcode = FETCH8();                                             \
+        cpu->cycles += cycleTable[opcode];                             \
+        goto *dispatch[opcode];                                        \
+    } while (0)
+
+void runCpu(Cpu* cpu) {
+    static const void* const dispatch[256] = {
+        &&op_00, &&op_01, &&op_02, &&op_03, &&op_04, &&op_05, &&op_06, &&op_07,
+        &&op_08, &&op_09, &&op_0A, &&op_0B, &&op_0C, &&op_0D, &&op_0E, &&op_0F,
+        &&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15, &&op_16, &&op_17,
+        &&op_18, &&op_19, &&op_1A, &&op_1B, &&op_1C, &&op_1D, &&op_1E, &&op_1F,
+        &&op_20, &&op_21, &&op_22, &&op_23, &&op_24, &&op_25, &&op_26, &&op_27,
+        &&op_28, &&op_29, &&op_2A, &&op_2B, &&op_2C, &&op_2D, &&op_2E, &&op_2F,
+        &&op_30, &&op_31, &&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37,
+        &&op_38, &&op_39, &&op_3A, &&op_3B, &&op_3C, &&op_3D, &&op_3E, &&op_3F,
+        &&op_40, &&op_41, &&op_42, &&op_43, &&op_44, &&op_45, &&op_46, &&op_47,
+        &&op_48, &&op_49, &&op_4A, &&op_4B, &&op_4C, &&op_4D, &&op_4E, &&op_4F,
+        &&op_50, &&op_51, &&op_52, &&op_53, &&op_54, &&op_55, &&op_56, &&op_57,
+        &&op_58, &&op_59, &&op_5A, &&op_5B, &&op_5C, &&op_5D, &&op_5E, &&op_5F,
+        &&op_60, &&op_61, &&op_62, &&op_63, &&op_64, &&op_65, &&op_66, &&op_67,
+        &&op_68, &&op_69, &&op_6A, &&op_6B, &&op_6C, &&op_6D, &&op_6E, &&op_6F,
+        &&op_70, &&op_71, &&op_72, &&op_73, &&op_74, &&op_75, &&op_76, &&op_77,
+        &&op_78, &&op_79, &&op_7A, &&op_7B, &&op_7C, &&op_7D, &&op_7E, &&op_7F,
+        &&op_80, &&op_81, &&op_82, &&op_83, &&op_84, &&op_85, &&op_86, &&op_87,
+        &&op_88, &&op_89, &&op_8A, &&op_8B, &&op_8C, &&op_8D, &&op_8E, &&op_8F,
+        &&op_90, &&op_91, &&op_92, &&op_93, &&op_94, &&op_95, &&op_96, &&op_97,
+        &&op_98, &&op_99, &&op_9A, &&op_9B, &&op_9C, &&op_9D, &&op_9E, &&op_9F,
+        &&op_A0, &&op_A1, &&op_A2, &&op_A3, &&op_A4, &&op_A5, &&op_A6, &&op_A7,
+        &&op_A8, &&op_A9, &&op_AA, &&op_AB, &&op_AC, &&op_AD, &&op_AE, &&op_AF,
+        &&op_B0, &&op_B1, &&op_B2, &&op_B3, &&op_B4, &&op_B5, &&op_B6, &&op_B7,
+        &&op_B8, &&op_B9, &&op_BA, &&op_BB, &&op_BC, &&op_BD, &&op_BE, &&op_BF,
+        &&op_C0, &&op_C1, &&op_C2, &&op_C3, &&op_C4, &&op_C5, &&op_C6, &&op_C7,
+        &&op_C8, &&op_C9, &&op_CA, &&op_CB, &&op_CC, &&op_CD, &&op_CE, &&op_CF,
+        &&op_D0, &&op_D1, &&op_D2, &&op_D3, &&op_D4, &&op_D5, &&op_D6, &&op_D7,
+        &&op_D8, &&op_D9, &&op_DA, &&op_DB, &&op_DC, &&op_DD, &&op_DE, &&op_DF,
+        &&op_E0, &&op_E1, &&op_E2, &&op_E3, &&op_E4, &&op_E5, &&op_E6, &&op_E7,
+        &&op_E8, &&op_E9, &&op_EA, &&op_EB, &&op_EC, &&op_ED, &&op_EE, &&op_EF,
+        &&op_F0, &&op_F1, &&op_F2, &&op_F3, &&op_F4, &&op_F5, &&op_F6, &&op_F7,
+        &&op_F8, &&op_F9, &&op_FA, &&op_FB, &&op_FC, &&op_FD, &&op_FE, &&op_FF,
+    };
+
+    if (cpu->jammed) {
+        if (cpu->cycles < cpu->deadline) cpu->cycles = cpu->deadline;
+        return;
+    }
+
+    Bus* bus = cpu->bus;
+    uint16_t pc = cpu->pc;
+    uint8_t a = cpu->a, x = cpu->x, y = cpu->y, s = cpu->s;
+    uint8_t flagC, flagI, flagD, flagV, resultN, resultZ;
+    UNPACK_FLAGS(cpu->p);
+
+    uint8_t opcode;
+    uint16_t addr;
+    uint8_t val;
+
+    NEXT();
+
+    op_00: BRK(); NEXT();                                                                               // BRK imp
+    op_01: ADDR_IZX(); a |= READ(addr); SET_NZ(a); NEXT();                                              // ORA izx
+    op_02: KIL(); NEXT();                                                                               // KIL imp
+    op_03: ADDR_IZX(); val = READ(addr); val = ASL(val); a |= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SLO izx
+    op_04: ADDR_ZP(); READ(addr); NEXT();                                                               // NOP zp
+    op_05: ADDR_ZP(); a |= READ(addr); SET_NZ(a); NEXT();                                               // ORA zp
+    op_06: ADDR_ZP(); val = READ(addr); val = ASL(val); WRITE(addr, val); NEXT();                       // ASL zp
+    op_07: ADDR_ZP(); val = READ(addr); val = ASL(val); a |= val; SET_NZ(a); WRITE(addr, val); NEXT();  // SLO zp
+    op_08: PUSH(PACK_FLAGS() | FLAG_B); NEXT();                                                         // PHP imp
+    op_09: ADDR_IMM(); a |= READ(addr); SET_NZ(a); NEXT();                                              // ORA imm
+    op_0A: a = ASL(a); NEXT();                                                                          // ASL acc
+    op_0B: ADDR_IMM(); a &= READ(addr); SET_NZ(a); flagC = a >> 7; NEXT();                              // ANC imm
+    op_0C: ADDR_ABS(); READ(addr); NEXT();                                                              // NOP abs
+    op_0D: ADDR_ABS(); a |= READ(addr); SET_NZ(a); NEXT();                                              // ORA abs
+    op_0E: ADDR_ABS(); val = READ(addr); val = ASL(val); WRITE(addr, val); NEXT();                      // ASL abs
+    op_0F: ADDR_ABS(); val = READ(addr); val = ASL(val); a |= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SLO abs
+    op_10: BRANCH(!(resultN & 0x80)); NEXT();                                                           // BPL rel
+    op_11: ADDR_IZY_READ(); a |= READ(addr); SET_NZ(a); NEXT();                                         // ORA izy
+    op_12: KIL(); NEXT();                                                                               // KIL imp
+    op_13: ADDR_IZY(); val = READ(addr); val = ASL(val); a |= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SLO izy
+    op_14: ADDR_ZPX(); READ(addr); NEXT();                                                              // NOP zpx
+    op_15: ADDR_ZPX(); a |= READ(addr); SET_NZ(a); NEXT();                                              // ORA zpx
+    op_16: ADDR_ZPX(); val = READ(addr); val = ASL(val); WRITE(addr, val); NEXT();                      // ASL zpx
+    op_17: ADDR_ZPX(); val = READ(addr); val = ASL(val); a |= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SLO zpx
+    op_18: flagC = 0; NEXT();                                                                           // CLC imp
+    op_19: ADDR_ABY_READ(); a |= READ(addr); SET_NZ(a); NEXT();                                         // ORA aby
+    op_1A: NEXT();                                                                                      // NOP imp
+    op_1B: ADDR_ABY(); val = READ(addr); val = ASL(val); a |= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SLO aby
+    op_1C: ADDR_ABX_READ(); READ(addr); NEXT();                                                         // NOP abx
+    op_1D: ADDR_ABX_READ(); a |= READ(addr); SET_NZ(a); NEXT();                                         // ORA abx
+    op_1E: ADDR_ABX(); val = READ(addr); val = ASL(val); WRITE(addr, val); NEXT();                      // ASL abx
+    op_1F: ADDR_ABX(); val = READ(addr); val = ASL(val); a |= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SLO abx
+    op_20: JSR(); NEXT();                                                                               // JSR abs
+    op_21: ADDR_IZX(); a &= READ(addr); SET_NZ(a); NEXT();                                              // AND izx
+    op_22: KIL(); NEXT();                                                                               // KIL imp
+    op_23: ADDR_IZX(); val = READ(addr); val = ROL(val); a &= val; SET_NZ(a); WRITE(addr, val); NEXT(); // RLA izx
+    op_24: ADDR_ZP(); BIT(READ(addr)); NEXT();                                                          // BIT zp
+    op_25: ADDR_ZP(); a &= READ(addr); SET_NZ(a); NEXT();                                               // AND zp
+    op_26: ADDR_ZP(); val = READ(addr); val = ROL(val); WRITE(addr, val); NEXT();                       // ROL zp
+    op_27: ADDR_ZP(); val = READ(addr); val = ROL(val); a &= val; SET_NZ(a); WRITE(addr, val); NEXT();  // RLA zp
+    op_28: PLP(); NEXT();                                                                               // PLP imp
+    op_29: ADDR_IMM(); a &= READ(addr); SET_NZ(a); NEXT();                                              // AND imm
+    op_2A: a = ROL(a); NEXT();                                                                          // ROL acc
+    op_2B: ADDR_IMM(); a &= READ(addr); SET_NZ(a); flagC = a >> 7; NEXT();                              // ANC imm
+    op_2C: ADDR_ABS(); BIT(READ(addr)); NEXT();                                                         // BIT abs
+    op_2D: ADDR_ABS(); a &= READ(addr); SET_NZ(a); NEXT();                                              // AND abs
+    op_2E: ADDR_ABS(); val = READ(addr); val = ROL(val); WRITE(addr, val); NEXT();                      // ROL abs
+    op_2F: ADDR_ABS(); val = READ(addr); val = ROL(val); a &= val; SET_NZ(a); WRITE(addr, val); NEXT(); // RLA abs
+    op_30: BRANCH(resultN & 0x80); NEXT();                                                              // BMI rel
+    op_31: ADDR_IZY_READ(); a &= READ(addr); SET_NZ(a); NEXT();                                         // AND izy
+    op_32: KIL(); NEXT();                                                                               // KIL imp
+    op_33: ADDR_IZY(); val = READ(addr); val = ROL(val); a &= val; SET_NZ(a); WRITE(addr, val); NEXT(); // RLA izy
+    op_34: ADDR_ZPX(); READ(addr); NEXT();                                                              // NOP zpx
+    op_35: ADDR_ZPX(); a &= READ(addr); SET_NZ(a); NEXT();                                              // AND zpx
+    op_36: ADDR_ZPX(); val = READ(addr); val = ROL(val); WRITE(addr, val); NEXT();                      // ROL zpx
+    op_37: ADDR_ZPX(); val = READ(addr); val = ROL(val); a &= val; SET_NZ(a); WRITE(addr, val); NEXT(); // RLA zpx
+    op_38: flagC = 1; NEXT();                                                                           // SEC imp
+    op_39: ADDR_ABY_READ(); a &= READ(addr); SET_NZ(a); NEXT();                                         // AND aby
+    op_3A: NEXT();                                                                                      // NOP imp
+    op_3B: ADDR_ABY(); val = READ(addr); val = ROL(val); a &= val; SET_NZ(a); WRITE(addr, val); NEXT(); // RLA aby
+    op_3C: ADDR_ABX_READ(); READ(addr); NEXT();                                                         // NOP abx
+    op_3D: ADDR_ABX_READ(); a &= READ(addr); SET_NZ(a); NEXT();                                         // AND abx
+    op_3E: ADDR_ABX(); val = READ(addr); val = ROL(val); WRITE(addr, val); NEXT();                      // ROL abx
+    op_3F: ADDR_ABX(); val = READ(addr); val = ROL(val); a &= val; SET_NZ(a); WRITE(addr, val); NEXT(); // RLA abx
+    op_40: RTI(); NEXT();                                                                               // RTI imp
+    op_41: ADDR_IZX(); a ^= READ(addr); SET_NZ(a); NEXT();                                              // EOR izx
+    op_42: KIL(); NEXT();                                                                               // KIL imp
+    op_43: ADDR_IZX(); val = READ(addr); val = LSR(val); a ^= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SRE izx
+    op_44: ADDR_ZP(); READ(addr); NEXT();                                                               // NOP zp
+    op_45: ADDR_ZP(); a ^= READ(addr); SET_NZ(a); NEXT();                                               // EOR zp
+    op_46: ADDR_ZP(); val = READ(addr); val = LSR(val); WRITE(addr, val); NEXT();                       // LSR zp
+    op_47: ADDR_ZP(); val = READ(addr); val = LSR(val); a ^= val; SET_NZ(a); WRITE(addr, val); NEXT();  // SRE zp
+    op_48: PUSH(a); NEXT();                                                                             // PHA imp
+    op_49: ADDR_IMM(); a ^= READ(addr); SET_NZ(a); NEXT();                                              // EOR imm
+    op_4A: a = LSR(a); NEXT();                                                                          // LSR acc
+    op_4B: ADDR_IMM(); a = LSR(a & READ(addr)); NEXT();                                                 // ALR imm
+    op_4C: pc = FETCH16(); NEXT();                                                                      // JMP abs
+    op_4D: ADDR_ABS(); a ^= READ(addr); SET_NZ(a); NEXT();                                              // EOR abs
+    op_4E: ADDR_ABS(); val = READ(addr); val = LSR(val); WRITE(addr, val); NEXT();                      // LSR abs
+    op_4F: ADDR_ABS(); val = READ(addr); val = LSR(val); a ^= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SRE abs
+    op_50: BRANCH(!flagV); NEXT();                                                                      // BVC rel
+    op_51: ADDR_IZY_READ(); a ^= READ(addr); SET_NZ(a); NEXT();                                         // EOR izy
+    op_52: KIL(); NEXT();                                                                               // KIL imp
+    op_53: ADDR_IZY(); val = READ(addr); val = LSR(val); a ^= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SRE izy
+    op_54: ADDR_ZPX(); READ(addr); NEXT();                                                              // NOP zpx
+    op_55: ADDR_ZPX(); a ^= READ(addr); SET_NZ(a); NEXT();                                              // EOR zpx
+    op_56: ADDR_ZPX(); val = READ(addr); val = LSR(val); WRITE(addr, val); NEXT();                      // LSR zpx
+    op_57: ADDR_ZPX(); val = READ(addr); val = LSR(val); a ^= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SRE zpx
+    op_58: flagI = 0; NEXT();                                                                           // CLI imp
+    op_59: ADDR_ABY_READ(); a ^= READ(addr); SET_NZ(a); NEXT();                                         // EOR aby
+    op_5A: NEXT();                                                                                      // NOP imp
+    op_5B: ADDR_ABY(); val = READ(addr); val = LSR(val); a ^= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SRE aby
+    op_5C: ADDR_ABX_READ(); READ(addr); NEXT();                                                         // NOP abx
+    op_5D: ADDR_ABX_READ(); a ^= READ(addr); SET_NZ(a); NEXT();                                         // EOR abx
+    op_5E: ADDR_ABX(); val = READ(addr); val = LSR(val); WRITE(addr, val); NEXT();                      // LSR abx
+    op_5F: ADDR_ABX(); val = READ(addr); val = LSR(val); a ^= val; SET_NZ(a); WRITE(addr, val); NEXT(); // SRE abx
+    op_60: RTS(); NEXT();                                                                               // RTS imp
+    op_61: ADDR_IZX(); ADC(READ(addr)); NEXT();                                                         // ADC izx
+    op_62: KIL(); NEXT();                                                                               // KIL imp
+    op_63: ADDR_IZX(); val = READ(addr); val = ROR(val); ADC(val); WRITE(addr, val); NEXT();            // RRA izx
+    op_64: ADDR_ZP(); READ(addr); NEXT();                                                               // NOP zp
+    op_65: ADDR_ZP(); ADC(READ(addr)); NEXT();                                                          // ADC zp
+    op_66: ADDR_ZP(); val = READ(addr); val = ROR(val); WRITE(addr, val); NEXT();                       // ROR zp
+    op_67: ADDR_ZP(); val = READ(addr); val = ROR(val); ADC(val); WRITE(addr, val); NEXT();             // RRA zp
+    op_68: a = PULL(); SET_NZ(a); NEXT();                                                               // PLA imp
+    op_69: ADDR_IMM(); ADC(READ(addr)); NEXT();                                                         // ADC imm
+    op_6A: a = ROR(a); NEXT();                                                                          // ROR acc
+    op_6B: ADDR_IMM(); ARR(READ(addr)); NEXT();                                                         // ARR imm
+    op_6C: JMP_INDIRECT(); NEXT();                                                                      // JMP ind
+    op_6D: ADDR_ABS(); ADC(READ(addr)); NEXT();                                                         // ADC abs
+    op_6E: ADDR_ABS(); val = READ(addr); val = ROR(val); WRITE(addr, val); NEXT();                      // ROR abs
+    op_6F: ADDR_ABS(); val = READ(addr); val = ROR(val); ADC(val); WRITE(addr, val); NEXT();            // RRA abs
+    op_70: BRANCH(flagV); NEXT();                                                                       // BVS rel
+    op_71: ADDR_IZY_READ(); ADC(READ(addr)); NEXT();                                                    // ADC izy
+    op_72: KIL(); NEXT();                                                                               // KIL imp
+    op_73: ADDR_IZY(); val = READ(addr); val = ROR(val); ADC(val); WRITE(addr, val); NEXT();            // RRA izy
+    op_74: ADDR_ZPX(); READ(addr); NEXT();                                                              // NOP zpx
+    op_75: ADDR_ZPX(); ADC(READ(addr)); NEXT();                                                         // ADC zpx
+    op_76: ADDR_ZPX(); val = READ(addr); val = ROR(val); WRITE(addr, val); NEXT();                      // ROR zpx
+    op_77: ADDR_ZPX(); val = READ(addr); val = ROR(val); ADC(val); WRITE(addr, val); NEXT();            // RRA zpx
+    op_78: flagI = 1; NEXT();                                                                           // SEI imp
+    op_79: ADDR_ABY_READ(); ADC(READ(addr)); NEXT();                                                    // ADC aby
+    op_7A: NEXT();                                                                                      // NOP imp
+    op_7B: ADDR_ABY(); val = READ(addr); val = ROR(val); ADC(val); WRITE(addr, val); NEXT();            // RRA aby
+    op_7C: ADDR_ABX_READ(); READ(addr); NEXT();                                                         // NOP abx
+    op_7D: ADDR_ABX_READ(); ADC(READ(addr)); NEXT();                                                    // ADC abx
+    op_7E: ADDR_ABX(); val = READ(addr); val = ROR(val); WRITE(addr, val); NEXT();                      // ROR abx
+    op_7F: ADDR_ABX(); val = READ(addr); val = ROR(val); ADC(val); WRITE(addr, val); NEXT();            // RRA abx
+    op_80: ADDR_IMM(); READ(addr); NEXT();                                                              // NOP imm
+    op_81: ADDR_IZX(); WRITE(addr, a); NEXT();                                                          // STA izx
+    op_82: ADDR_IMM(); READ(addr); NEXT();                                                              // NOP imm
+    op_83: ADDR_IZX(); WRITE(addr, a & x); NEXT();                                                      // SAX izx
+    op_84: ADDR_ZP(); WRITE(addr, y); NEXT();                                                           // STY zp
+    op_85: ADDR_ZP(); WRITE(addr, a); NEXT();                                                           // STA zp
+    op_86: ADDR_ZP(); WRITE(addr, x); NEXT();                                                           // STX zp
+    op_87: ADDR_ZP(); WRITE(addr, a & x); NEXT();                                                       // SAX zp
+    op_88: y--; SET_NZ(y); NEXT();                                                                      // DEY imp
+    op_89: ADDR_IMM(); READ(addr); NEXT();                                                              // NOP imm
+    op_8A: a = x; SET_NZ(a); NEXT();                                                                    // TXA imp
+    op_8B: ADDR_IMM(); a = x & READ(addr); SET_NZ(a); NEXT();                                           // XAA imm
+    op_8C: ADDR_ABS(); WRITE(addr, y); NEXT();                                                          // STY abs
+    op_8D: ADDR_ABS(); WRITE(addr, a); NEXT();                                                          // STA abs
+    op_8E: ADDR_ABS(); WRITE(addr, x); NEXT();                                                          // STX abs
+    op_8F: ADDR_ABS(); WRITE(addr, a & x); NEXT();                                                      // SAX abs
+    op_90: BRANCH(!flagC); NEXT();                                                                      // BCC rel
+    op_91: ADDR_IZY(); WRITE(addr, a); NEXT();                                                          // STA izy
+    op_92: KIL(); NEXT();                                                                               // KIL imp
+    op_93: ADDR_IZY(); WRITE(addr, a & x & ((addr >> 8) + 1)); NEXT();                                  // AHX izy
+    op_94: ADDR_ZPX(); WRITE(addr, y); NEXT();                                                          // STY zpx
+    op_95: ADDR_ZPX(); WRITE(addr, a); NEXT();                                                          // STA zpx
+    op_96: ADDR_ZPY(); WRITE(addr, x); NEXT();                                                          // STX zpy
+    op_97: ADDR_ZPY(); WRITE(addr, a & x); NEXT();                                                      // SAX zpy
+    op_98: a = y; SET_NZ(a); NEXT();                                                                    // TYA imp
+    op_99: ADDR_ABY(); WRITE(addr, a); NEXT();                                                          // STA aby
+    op_9A: s = x; NEXT();                                                                               // TXS imp
+    op_9B: ADDR_ABY(); s = a & x; WRITE(addr, s & ((addr >> 8) + 1)); NEXT();                           // TAS aby
+    op_9C: ADDR_ABX(); WRITE(addr, y & ((addr >> 8) + 1)); NEXT();                                      // SHY abx
+    op_9D: ADDR_ABX(); WRITE(addr, a); NEXT();                                                          // STA abx
+    op_9E: ADDR_ABY(); WRITE(addr, x & ((addr >> 8) + 1)); NEXT();                                      // SHX aby
+    op_9F: ADDR_ABY(); WRITE(addr, a & x & ((addr >> 8) + 1)); NEXT();                                  // AHX aby
+    op_A0: ADDR_IMM(); y = READ(addr); SET_NZ(y); NEXT();                                               // LDY imm
+    op_A1: ADDR_IZX(); a = READ(addr); SET_NZ(a); NEXT();                                               // LDA izx
+    op_A2: ADDR_IMM(); x = READ(addr); SET_NZ(x); NEXT();                                               // LDX imm
+    op_A3: ADDR_IZX(); a = x = READ(addr); SET_NZ(a); NEXT();                                           // LAX izx
+    op_A4: ADDR_ZP(); y = READ(addr); SET_NZ(y); NEXT();                                                // LDY zp
+    op_A5: ADDR_ZP(); a = READ(addr); SET_NZ(a); NEXT();                                                // LDA zp
+    op_A6: ADDR_ZP(); x = READ(addr); SET_NZ(x); NEXT();                                                // LDX zp
+    op_A7: ADDR_ZP(); a = x = READ(addr); SET_NZ(a); NEXT();                                            // LAX zp
+    op_A8: y = a; SET_NZ(y); NEXT();                                                                    // TAY imp
+    op_A9: ADDR_IMM(); a = READ(addr); SET_NZ(a); NEXT();                                               // LDA imm
+    op_AA: x = a; SET_NZ(x); NEXT();                                                                    // TAX imp
+    op_AB: ADDR_IMM(); a = x = READ(addr); SET_NZ(a); NEXT();                                           // LAX imm
+    op_AC: ADDR_ABS(); y = READ(addr); SET_NZ(y); NEXT();                                               // LDY abs
+    op_AD: ADDR_ABS(); a = READ(addr); SET_NZ(a); NEXT();                                               // LDA abs
+    op_AE: ADDR_ABS(); x = READ(addr); SET_NZ(x); NEXT();                                               // LDX abs
+    op_AF: ADDR_ABS(); a = x = READ(addr); SET_NZ(a); NEXT();                                           // LAX abs
+    op_B0: BRANCH(flagC); NEXT();                                                                       // BCS rel
+    op_B1: ADDR_IZY_READ(); a = READ(addr); SET_NZ(a); NEXT();                                          // LDA izy
+    op_B2: KIL(); NEXT();                                                                               // KIL imp
+    op_B3: ADDR_IZY_READ(); a = x = READ(addr); SET_NZ(a); NEXT();                                      // LAX izy
+    op_B4: ADDR_ZPX(); y = READ(addr); SET_NZ(y); NEXT();                                               // LDY zpx
+    op_B5: ADDR_ZPX(); a = READ(addr); SET_NZ(a); NEXT();                                               // LDA zpx
+    op_B6: ADDR_ZPY(); x = READ(addr); SET_NZ(x); NEXT();                                               // LDX zpy
+    op_B7: ADDR_ZPY(); a = x = READ(addr); SET_NZ(a); NEXT();                                           // LAX zpy
+    op_B8: flagV = 0; NEXT();                                                                           // CLV imp
+    op_B9: ADDR_ABY_READ(); a = READ(addr); SET_NZ(a); NEXT();                                          // LDA aby
+    op_BA: x = s; SET_NZ(x); NEXT();                                                                    // TSX imp
+    op_BB: ADDR_ABY_READ(); a = x = s = READ(addr) & s; SET_NZ(a); NEXT();                              // LAS aby
+    op_BC: ADDR_ABX_READ(); y = READ(addr); SET_NZ(y); NEXT();                                          // LDY abx
+    op_BD: ADDR_ABX_READ(); a = READ(addr); SET_NZ(a); NEXT();                                          // LDA abx
+    op_BE: ADDR_ABY_READ(); x = READ(addr); SET_NZ(x); NEXT();                                          // LDX aby
+    op_BF: ADDR_ABY_READ(); a = x = READ(addr); SET_NZ(a); NEXT();                                      // LAX aby
+    op_C0: ADDR_IMM(); COMPARE(y, READ(addr)); NEXT();                                                  // CPY imm
+    op_C1: ADDR_IZX(); COMPARE(a, READ(addr)); NEXT();                                                  // CMP izx
+    op_C2: ADDR_IMM(); READ(addr); NEXT();                                                              // NOP imm
+    op_C3: ADDR_IZX(); val = READ(addr); val--; COMPARE(a, val); WRITE(addr, val); NEXT();              // DCP izx
+    op_C4: ADDR_ZP(); COMPARE(y, READ(addr)); NEXT();                                                   // CPY zp
+    op_C5: ADDR_ZP(); COMPARE(a, READ(addr)); NEXT();                                                   // CMP zp
+    op_C6: ADDR_ZP(); val = READ(addr); val--; SET_NZ(val); WRITE(addr, val); NEXT();                   // DEC zp
+    op_C7: ADDR_ZP(); val = READ(addr); val--; COMPARE(a, val); WRITE(addr, val); NEXT();               // DCP zp
+    op_C8: y++; SET_NZ(y); NEXT();                                                                      // INY imp
+    op_C9: ADDR_IMM(); COMPARE(a, READ(addr)); NEXT();                                                  // CMP imm
+    op_CA: x--; SET_NZ(x); NEXT();                                                                      // DEX imp
+    op_CB: ADDR_IMM(); AXS(READ(addr)); NEXT();                                                         // AXS imm
+    op_CC: ADDR_ABS(); COMPARE(y, READ(addr)); NEXT();                                                  // CPY abs
+    op_CD: ADDR_ABS(); COMPARE(a, READ(addr)); NEXT();                                                  // CMP abs
+    op_CE: ADDR_ABS(); val = READ(addr); val--; SET_NZ(val); WRITE(addr, val); NEXT();                  // DEC abs
+    op_CF: ADDR_ABS(); val = READ(addr); val--; COMPARE(a, val); WRITE(addr, val); NEXT();              // DCP abs
+    op_D0: BRANCH(resultZ); NEXT();                                                                     // BNE rel
+    op_D1: ADDR_IZY_READ(); COMPARE(a, READ(addr)); NEXT();                                             // CMP izy
+    op_D2: KIL(); NEXT();                                                                               // KIL imp
+    op_D3: ADDR_IZY(); val = READ(addr); val--; COMPARE(a, val); WRITE(addr, val); NEXT();              // DCP izy
+    op_D4: ADDR_ZPX(); READ(addr); NEXT();                                                              // NOP zpx
+    op_D5: ADDR_ZPX(); COMPARE(a, READ(addr)); NEXT();                                                  // CMP zpx
+    op_D6: ADDR_ZPX(); val = READ(addr); val--; SET_NZ(val); WRITE(addr, val); NEXT();                  // DEC zpx
+    op_D7: ADDR_ZPX(); val = READ(addr); val--; COMPARE(a, val); WRITE(addr, val); NEXT();              // DCP zpx
+    op_D8: flagD = 0; NEXT();                                                                           // CLD imp
+    op_D9: ADDR_ABY_READ(); COMPARE(a, READ(addr)); NEXT();                                             // CMP aby
+    op_DA: NEXT();                                                                                      // NOP imp
+    op_DB: ADDR_ABY(); val = READ(addr); val--; COMPARE(a, val); WRITE(addr, val); NEXT();              // DCP aby
+    op_DC: ADDR_ABX_READ(); READ(addr); NEXT();                                                         // NOP abx
+    op_DD: ADDR_ABX_READ(); COMPARE(a, READ(addr)); NEXT();                                             // CMP abx
+    op_DE: ADDR_ABX(); val = READ(addr); val--; SET_NZ(val); WRITE(addr, val); NEXT();                  // DEC abx
+    op_DF: ADDR_ABX(); val = READ(addr); val--; COMPARE(a, val); WRITE(addr, val); NEXT();              // DCP abx
+    op_E0: ADDR_IMM(); COMPARE(x, READ(addr)); NEXT();                                                  // CPX imm
+    op_E1: ADDR_IZX(); ADC(READ(addr) ^ 0xFF); NEXT();                                                  // SBC izx
+    op_E2: ADDR_IMM(); READ(addr); NEXT();                                                              // NOP imm
+    op_E3: ADDR_IZX(); val = READ(addr); val++; ADC(val ^ 0xFF); WRITE(addr, val); NEXT();              // ISC izx
+    op_E4: ADDR_ZP(); COMPARE(x, READ(addr)); NEXT();                                                   // CPX zp
+    op_E5: ADDR_ZP(); ADC(READ(addr) ^ 0xFF); NEXT();                                                   // SBC zp
+    op_E6: ADDR_ZP(); val = READ(addr); val++; SET_NZ(val); WRITE(addr, val); NEXT();                   // INC zp
+    op_E7: ADDR_ZP(); val = READ(addr); val++; ADC(val ^ 0xFF); WRITE(addr, val); NEXT();               // ISC zp
+    op_E8: x++; SET_NZ(x); NEXT();                                                                      // INX imp
+    op_E9: ADDR_IMM(); ADC(READ(addr) ^ 0xFF); NEXT();                                                  // SBC imm
+    op_EA: NEXT();                                                                                      // NOP imp
+    op_EB: ADDR_IMM(); ADC(READ(addr) ^ 0xFF); NEXT();                                                  // SBC imm
+    op_EC: ADDR_ABS(); COMPARE(x, READ(addr)); NEXT();                                                  // CPX abs
+    op_ED: ADDR_ABS(); ADC(READ(addr) ^ 0xFF); NEXT();                                                  // SBC abs
+    op_EE: ADDR_ABS(); val = READ(addr); val++; SET_NZ(val); WRITE(addr, val); NEXT();                  // INC abs
+    op_EF: ADDR_ABS(); val = READ(addr); val++; ADC(val ^ 0xFF); WRITE(addr, val); NEXT();              // ISC abs
+    op_F0: BRANCH(!resultZ); NEXT();                                                                    // BEQ rel
+    op_F1: ADDR_IZY_READ(); ADC(READ(addr) ^ 0xFF); NEXT();                                             // SBC izy
+    op_F2: KIL(); NEXT();                                                                               // KIL imp
+    op_F3: ADDR_IZY(); val = READ(addr); val++; ADC(val ^ 0xFF); WRITE(addr, val); NEXT();              // ISC izy
+    op_F4: ADDR_ZPX(); READ(addr); NEXT();                                                              // NOP zpx
+    op_F5: ADDR_ZPX(); ADC(READ(addr) ^ 0xFF); NEXT();                                                  // SBC zpx
+    op_F6: ADDR_ZPX(); val = READ(addr); val++; SET_NZ(val); WRITE(addr, val); NEXT();                  // INC zpx
+    op_F7: ADDR_ZPX(); val = READ(addr); val++; ADC(val ^ 0xFF); WRITE(addr, val); NEXT();              // ISC zpx
+    op_F8: flagD = 1; NEXT();                                                                           // SED imp
+    op_F9: ADDR_ABY_READ(); ADC(READ(addr) ^ 0xFF); NEXT();                                             // SBC aby
+    op_FA: NEXT();                                                                                      // NOP imp
+    op_FB: ADDR_ABY(); val = READ(addr); val++; ADC(val ^ 0xFF); WRITE(addr, val); NEXT();              // ISC aby
+    op_FC: ADDR_ABX_READ(); READ(addr); NEXT();                                                         // NOP abx
+    op_FD: ADDR_ABX_READ(); ADC(READ(addr) ^ 0xFF); NEXT();                                             // SBC abx
+    op_FE: ADDR_ABX(); val = READ(addr); val++; SET_NZ(val); WRITE(addr, val); NEXT();                  // INC abx
+    op_FF: ADDR_ABX(); val = READ(addr); val++; ADC(val ^ 0xFF); WRITE(addr, val); NEXT();              // ISC abx
+
+interrupt:
+    PUSH(pc >> 8);
+    PUSH(pc & 0xFF);
+    PUSH(PACK_FLAGS());
+    flagI = 1;
+    cpu->cycles += INTERRUPT_CYCLES;
+    if (cpu->nmi) {
+        cpu->nmi = false;
+        pc = READ16(VECTOR_NMI);
+    } else {
+        pc = READ16(VECTOR_IRQ);
+    }
+    NEXT();
+
+done:
+    if (cpu->jammed && cpu->cycles < cpu->deadline) cpu->cycles = cpu->deadline;
+    cpu->pc = pc;
+    cpu->a = a;
+    cpu->x = x;
+    cpu->y = y;
+    cpu->s = s;
+    cpu->p = PACK_FLAGS();
+}
@@ -0,0 +1,44 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bus.h"
+
+// IRQ sources; the CPU takes an interrupt while any of them is asserted
+#define IRQ_APU_FRAME 0x01
+#define IRQ_APU_DMC   0x02
+#define IRQ_MAPPER    0x04
+
+// 2A03 core: a 6502 without decimal mode. Instructions execute whole and are
+// charged their documented cycle counts, page-crossing and branch penalties
+// included; memory accesses are stamped with the cycle count at the end of the
+// instruction.
+//
+// The CPU runs ahead of every other component. runCpu executes until the cycle
+// counter reaches `deadline`, the time of the next event the rest of the
+// machine has scheduled; a handler may pull the deadline in when an access
+// makes an earlier event due.
+typedef struct {
+    uint16_t pc;
+    uint8_t a, x, y;
+    uint8_t s;
+    uint8_t p;          // Status flags; only current while the CPU is not running
+    bool nmi;           // Edge-triggered NMI waiting to be taken
+    uint8_t irq;        // Asserted IRQ_* lines
+    bool jammed;        // Executed a KIL opcode; only a reset recovers
+    int64_t cycles;     // CPU cycles since power-on
+    int64_t deadline;
+
+    Bus* bus;
+} Cpu;
+
+void initCpu(Cpu* cpu, Bus* bus);
+
+// Loads PC from the reset vector and applies the reset side effects.
+void resetCpu(Cpu* cpu);
+
+void runCpu(Cpu* cpu);
+
+#endif
@@ -0,0 +1,73 @@
+#include "emu.h"
+
+// Pulse 1 timer periods for each semitone step above A440:
+// N = 1789773 / (16 * f) - 1, rounded
+static const uint16_t tonePeriods[TONE_STEPS] = {
+    253, 239, 225, 213, 201, 189, 179, 169, 159, 150, 142, 134, 126, 119, 112, 106
+};
+
+// Programs pulse 1 with the current test tone: 50 % duty, constant volume,
+// halted length counter. Every period fits the low timer byte, so $4003 (which
+// restarts the sequencer) is only written once at startup.
+static void writeTestTone(EmuContext* emu) {
+    writeNes(&emu->nes, 0x4000, (uint8_t)(0xB0 | emu->toneVolume));
+    writeNes(&emu->nes, 0x4002, (uint8_t)tonePeriods[emu->toneStep]);
+}
+
+void initEmuContext(EmuContext* emu, double sampleRate, const Cartridge* cart) {
+    initBlipBuffer(&emu->blip, APU_CLOCK_NTSC, sampleRate);
+    initNes(&emu->nes, &emu->blip, cart);
+    emu->frames = 0;
+    emu->toneStep = 0;
+    emu->toneVolume = 0;
+    emu->testTone = cart == NULL;
+    if (!emu->testTone) return;
+
+    writeNes(&emu->nes, 0x4015, 0x01);
+    writeNes(&emu->nes, 0x4001, 0x08); // Sweep off, negate set so the target never mutes
+    writeNes(&emu->nes, 0x4003, 0x00);
+    writeTestTone(emu);
+}
+
+int runEmuFrame(EmuContext* emu, int16_t* samples) {
+    runNesFrame(&emu->nes);
+    emu->frames++;
+    uint64_t start = beginProfile(emu->nes.profile);
+    int numSamples = readBlipSamples(&emu->blip, samples, BLIP_MAX_SAMPLES);
+    endProfile(emu->nes.profile, PROFILE_MIXING, start);
+
+    if (!emu->testTone) return numSamples;
+
+    // Step semitone and volume every TONE_STEP_FRAMES frames. Going by
+    // emulated time, not by the samples the host resampled them to, keeps the
+    // session deterministic whatever the output rate.
+    if (emu->frames % TONE_STEP_FRAMES == 0) {
+        emu->toneStep = (emu->toneStep + 1) % TONE_STEPS;
+        emu->toneVolume = (emu->toneVolume + 1) % TONE_STEPS;
+        writeTestTone(emu);
+    }
+    return numSamples;
+}
+
+static void saveTone(const EmuContext* emu, EmuState* state) {
+    state->frames = emu->frames;
+    state->toneStep = emu->toneStep;
+    state->toneVolume = emu->toneVolume;
+}
+
+void saveEmuState(EmuContext* emu, EmuState* state) {
+    saveNesState(&emu->nes, &state->nes);
+    saveTone(emu, state);
+}
+
+void updateEmuState(EmuContext* emu, EmuState* state) {
+    updateNesState(&emu->nes, &state->nes);
+    saveTone(emu, state);
+}
+
+void loadEmuState(EmuContext* emu, const EmuState* state) {
+    loadNesState(&emu->nes, &state->nes);
+    emu->frames = state->frames;
+    emu->toneStep = state->toneStep;
+    emu->toneVolume = state->toneVolume;
+}
@@ -0,0 +1,50 @@
+#ifndef EMU_H
+#define EMU_H
+
+#include <stdint.h>
+
+#include "blip_buffer.h"
+#include "nes.h"
+#include "savestate.h"
+
+#define TONE_STEPS 16            // Test tone pitch and volume steps
+#define TONE_STEP_FRAMES 3       // Frames between test tone steps, about 50 ms
+
+// Everything one emulation session owns: the machine, its audio synthesis and,
+// when no cartridge is inserted, the test tone it plays. Sessions share
+// nothing writable, so any number of them can live in one process and be
+// stepped on different threads; a cartridge is read-only and can be inserted
+// into all of them. Only presentation (window, overlay, audio device) belongs
+// to the host.
+typedef struct {
+    Nes nes;
+    BlipBuffer blip;
+    uint32_t frames;        // Frames emulated so far
+    uint8_t toneStep;       // Semitone above A440
+    uint8_t toneVolume;
+    bool testTone;          // Played when there is no game to drive the APU
+} EmuContext;
+
+// Snapshot of a session: the machine plus the test tone driving it
+typedef struct {
+    NesState nes;
+    uint32_t frames;
+    uint8_t toneStep;
+    uint8_t toneVolume;
+} EmuState;
+
+// Powers the machine on with `cart` inserted, or with none and the test tone
+// playing when NULL; audio comes out at `sampleRate`.
+void initEmuContext(EmuContext* emu, double sampleRate, const Cartridge* cart);
+
+// Emulates one frame and reads its audio into `samples`, which must have room
+// for BLIP_MAX_SAMPLES. Returns the number of samples.
+int runEmuFrame(EmuContext* emu, int16_t* samples);
+
+// Savestates at frame boundaries; see savestate.h. Buffered audio is not part
+// of a state, so a load continues the sample stream without a gap.
+void saveEmuState(EmuContext* emu, EmuState* state);
+void updateEmuState(EmuContext* emu, EmuState* state);
+void loadEmuState(EmuContext* emu, const EmuState* state);
+
+#endif
@@ -0,0 +1,36 @@
+#include "frame_pacer.h"
+
+void initFramePacer(FramePacer* pacer, double frameRate) {
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    pacer->period = (Uint64)(freq / frameRate + 0.5);
+    pacer->spin = freq / 1000;
+    pacer->deadline = SDL_GetPerformanceCounter() + pacer->period;
+    pacer->frames = 0;
+    pacer->lateFrames = 0;
+}
+
+bool waitNextFrame(FramePacer* pacer) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    bool late = false;
+
+    if (now >= pacer->deadline) {
+        late = true;
+        if (now - pacer->deadline >= pacer->period) {
+            pacer->deadline = now;
+        }
+    } else {
+        Uint64 remaining = pacer->deadline - now;
+        if (remaining > pacer->spin) {
+            Uint64 sleepTicks = remaining - pacer->spin;
+            SDL_Delay((Uint32)(sleepTicks * 1000 / SDL_GetPerformanceFrequency()));
+        }
+        while ((now = SDL_GetPerformanceCounter()) < pacer->deadline) {
+            // Spin out the last millisecond
+        }
+    }
+
+    pacer->deadline += pacer->period;
+    pacer->frames++;
+    if (late) pacer->lateFrames++;
+    return late;
+}
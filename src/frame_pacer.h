@@ -0,0 +1,35 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Refresh rates of the real consoles, not the rounded 60/50 Hz
+#define NTSC_FRAME_RATE 60.0988
+#define PAL_FRAME_RATE 50.007
+
+// Frame scheduler on the performance counter. Each frame has an absolute
+// deadline one period after the previous one, so time spent handling events
+// and rendering is absorbed instead of added to the sleep, and rounding never
+// accumulates into drift. The pacer sleeps until about a millisecond before
+// the deadline and spins the rest, because SDL_Delay alone overshoots.
+//
+// The pacer runs on the emulation thread and never waits for the display;
+// under --vsync only the presenter does.
+typedef struct {
+    Uint64 period;   // Counter ticks per emulated frame
+    Uint64 deadline; // Counter value at which the current frame ends
+    Uint64 spin;     // Final stretch busy-waited instead of slept
+    uint32_t frames;
+    uint32_t lateFrames; // Frames that finished after their deadline
+} FramePacer;
+
+void initFramePacer(FramePacer* pacer, double frameRate);
+
+// Waits for the end of the current frame. Returns true when the frame was
+// already late; if it is more than a whole frame behind, the schedule restarts
+// from now instead of trying to catch up with a burst of frames.
+bool waitNextFrame(FramePacer* pacer);
+
+#endif
@@ -0,0 +1,87 @@
+#include "glyph_atlas.h"
+
+bool initGlyphAtlas(GlyphAtlas* atlas, SDL_Renderer* renderer, TTF_Font* font) {
+    int advance = 0;
+    if (TTF_GlyphMetrics(font, 'M', NULL, NULL, NULL, NULL, &advance) != 0) return false;
+
+    atlas->cellW = advance;
+    atlas->cellH = TTF_FontHeight(font);
+    atlas->numGlyphs = 0;
+
+    int rows = (GLYPH_COUNT + GLYPH_ATLAS_COLUMNS - 1) / GLYPH_ATLAS_COLUMNS;
+    int atlasW = GLYPH_ATLAS_COLUMNS * atlas->cellW;
+    int atlasH = rows * atlas->cellH;
+
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, atlasW, atlasH, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!sheet) return false;
+    SDL_FillRect(sheet, NULL, 0);
+
+    // Solid glyph surfaces are color-keyed on their background, so blitting them
+    // onto the transparent sheet leaves only opaque white glyph pixels.
+    SDL_Color white = { 255, 255, 255, 255 };
+    for (int i = 0; i < GLYPH_COUNT; ++i) {
+        SDL_Surface* glyph = TTF_RenderGlyph_Solid(font, (Uint16)(GLYPH_FIRST + i), white);
+        if (!glyph) continue;
+
+        SDL_Rect src = { 0, 0, atlas->cellW, atlas->cellH };
+        SDL_Rect dst = { (i % GLYPH_ATLAS_COLUMNS) * atlas->cellW, (i / GLYPH_ATLAS_COLUMNS) * atlas->cellH, 0, 0 };
+        SDL_BlitSurface(glyph, &src, sheet, &dst);
+        SDL_FreeSurface(glyph);
+    }
+
+    atlas->texture = SDL_CreateTextureFromSurface(renderer, sheet);
+    SDL_FreeSurface(sheet);
+    if (!atlas->texture) return false;
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+
+    atlas->invW = 1.0f / atlasW;
+    atlas->invH = 1.0f / atlasH;
+
+    for (int i = 0; i < GLYPH_BATCH_MAX; ++i) {
+        int* idx = &atlas->indices[i * 6];
+        int v = i * 4;
+        idx[0] = v;     idx[1] = v + 1; idx[2] = v + 2;
+        idx[3] = v + 2; idx[4] = v + 1; idx[5] = v + 3;
+    }
+
+    return true;
+}
+
+void destroyGlyphAtlas(GlyphAtlas* atlas) {
+    if (atlas->texture) SDL_DestroyTexture(atlas->texture);
+    atlas->texture = NULL;
+}
+
+void renderText(SDL_Renderer* renderer, GlyphAtlas* atlas, const char* text, int x, int y, SDL_Color color) {
+    float cw = (float)atlas->cellW;
+    float ch = (float)atlas->cellH;
+    float uw = cw * atlas->invW;
+    float vh = ch * atlas->invH;
+    float px = (float)x;
+    float py = (float)y;
+
+    for (const unsigned char* p = (const unsigned char*)text; *p; ++p, px += cw) {
+        int c = *p;
+        if (c == ' ') continue;
+        if (c < GLYPH_FIRST || c > GLYPH_LAST) c = '?';
+
+        if (atlas->numGlyphs == GLYPH_BATCH_MAX) flushText(renderer, atlas);
+
+        int cell = c - GLYPH_FIRST;
+        float u = (cell % GLYPH_ATLAS_COLUMNS) * uw;
+        float v = (cell / GLYPH_ATLAS_COLUMNS) * vh;
+
+        SDL_Vertex* q = &atlas->vertices[atlas->numGlyphs++ * 4];
+        q[0] = (SDL_Vertex){ { px,      py      }, color, { u,      v      } };
+        q[1] = (SDL_Vertex){ { px + cw, py      }, color, { u + uw, v      } };
+        q[2] = (SDL_Vertex){ { px,      py + ch }, color, { u,      v + vh } };
+        q[3] = (SDL_Vertex){ { px + cw, py + ch }, color, { u + uw, v + vh } };
+    }
+}
+
+void flushText(SDL_Renderer* renderer, GlyphAtlas* atlas) {
+    if (atlas->numGlyphs == 0) return;
+    SDL_RenderGeometry(renderer, atlas->texture, atlas->vertices, atlas->numGlyphs * 4,
+                       atlas->indices, atlas->numGlyphs * 6);
+    atlas->numGlyphs = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdbool.h>
+
+// Printable ASCII is rasterized once into a single texture; anything outside
+// this range is drawn as '?'.
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+#define GLYPH_ATLAS_COLUMNS 16
+#define GLYPH_BATCH_MAX 1024 // Glyph quads buffered before an implicit flush
+
+// Glyph atlas for a monospace font. Every glyph occupies one cell of the same
+// size, so strings are laid out by advancing a fixed cell width and no per-glyph
+// metrics are stored. Glyphs are rasterized white and tinted through the vertex
+// color, so one texture serves every text color.
+typedef struct {
+    SDL_Texture* texture;
+    int cellW;
+    int cellH;
+    float invW; // 1 / texture width, for texture coordinates
+    float invH;
+    int numGlyphs; // Quads waiting in the batch
+    SDL_Vertex vertices[GLYPH_BATCH_MAX * 4];
+    int indices[GLYPH_BATCH_MAX * 6]; // Constant quad topology, filled once
+} GlyphAtlas;
+
+bool initGlyphAtlas(GlyphAtlas* atlas, SDL_Renderer* renderer, TTF_Font* font);
+void destroyGlyphAtlas(GlyphAtlas* atlas);
+
+// Queues a string for drawing; nothing reaches the renderer until flushText
+// (or until the batch fills up).
+void renderText(SDL_Renderer* renderer, GlyphAtlas* atlas, const char* text, int x, int y, SDL_Color color);
+
+// Submits all queued glyphs as a single SDL_RenderGeometry call.
+void flushText(SDL_Renderer* renderer, GlyphAtlas* atlas);
+
+#endif
@@ -0,0 +1,18 @@
+#include "input.h"
+
+#include <string.h>
+
+void initInput(Input* input) {
+    memset(input, 0, sizeof(*input));
+}
+
+void bindInput(Input* input, SDL_Scancode key, int port, uint8_t button) {
+    if ((unsigned)key >= SDL_NUM_SCANCODES || port < 0 || port >= INPUT_PORTS) return;
+
+    // Release the button if it was held through the old binding
+    InputBinding old = input->bindings[key];
+    input->state[old.port] &= (uint8_t)~old.mask;
+
+    input->bindings[key].port = (uint8_t)port;
+    input->bindings[key].mask = button;
+}
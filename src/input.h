@@ -0,0 +1,46 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define INPUT_PORTS 2
+
+// Controller button bits, in the order the NES shifts them out
+#define BUTTON_A      0x01
+#define BUTTON_B      0x02
+#define BUTTON_SELECT 0x04
+#define BUTTON_START  0x08
+#define BUTTON_UP     0x10
+#define BUTTON_DOWN   0x20
+#define BUTTON_LEFT   0x40
+#define BUTTON_RIGHT  0x80
+
+typedef struct {
+    uint8_t port;
+    uint8_t mask; // Button bit; 0 leaves the scancode unbound
+} InputBinding;
+
+// Keyboard input. Every scancode maps straight to a (port, button) pair, and
+// each port's held buttons are kept as the byte the controller would shift
+// out, so a key event is one table lookup and one masked store, and sampling a
+// controller is a load.
+typedef struct {
+    InputBinding bindings[SDL_NUM_SCANCODES];
+    uint8_t state[INPUT_PORTS];
+} Input;
+
+void initInput(Input* input);
+
+// Binds a key to a button; a key drives at most one button, the last bound wins.
+void bindInput(Input* input, SDL_Scancode key, int port, uint8_t button);
+
+static inline void handleInputKey(Input* input, SDL_Scancode key, bool pressed) {
+    if ((unsigned)key >= SDL_NUM_SCANCODES) return;
+    InputBinding b = input->bindings[key];
+    uint8_t* state = &input->state[b.port];
+    *state = (uint8_t)((*state & ~b.mask) | (b.mask & -(uint8_t)pressed));
+}
+
+#endif
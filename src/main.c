@@ -1,180 +1,789 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <signal.h>
 #include <string.h>
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
+
+#include "apu.h"
+#include "audio_ring.h"
+#include "blip_buffer.h"
+#include "emu.h"
+#include "rate_control.h"
+#include "frame_pacer.h"
+#include "glyph_atlas.h"
+#include "input.h"
+#include "movie.h"
+#include "nes.h"
+#include "netplay.h"
+#include "overlay.h"
+#include "perf_hud.h"
+#include "profile.h"
+#include "rewind.h"
+#include "run_ahead.h"
+#include "swap_chain.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "video.h"
 
 #define WIDTH 720
 #define HEIGHT 480
 #define FONT_PATH "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf"
 #define FONT_SIZE 16
 #define SAMPLE_RATE 44100
-#define BASE_FREQUENCY 440
-#define MAX_SEMITONE_STEPS 16
-#define AMPLITUDE 28000
-
-// Define a mapping from keys to NES controller buttons and labels
+#define AUDIO_DEVICE_SAMPLES 512 // Default device buffer (~11.6 ms); see --audio-buffer
+#define PRESENT_WAIT_MS 50       // Longest the presenter waits for a frame before polling events again
+#define REWIND_SECONDS 60
+#define REWIND_BUFFER_BYTES (4 << 20)
+#define REWIND_KEY SDL_SCANCODE_BACKSPACE
+#define HUD_KEY SDL_SCANCODE_F1       // Shows and hides the performance HUD
+#define TRACE_KEY SDL_SCANCODE_F12    // Dumps the trace rings in VERSANES_TRACE builds
+#define FAST_FORWARD_KEY SDL_SCANCODE_TAB // Held to fast-forward
+#define FAST_FORWARD_MAX 16      // Largest --fast-forward multiplier
+#define FAST_FORWARD_BUDGET 0.75 // Share of a host frame unthrottled fast-forward fills with emulation
+#define FAST_FORWARD_MAX_FRAMES 64 // Cap on the frames one unthrottled host frame runs
+#define TRACE_PATH "versanes-trace.json"
+#define BENCHMARK_FRAMES 3000    // Default length of a --benchmark run, about 50 s of play
+#define HEADLESS_ROUND_FRAMES 60 // Frames each headless session runs per pool batch
+
+// Default key bindings. Keys are scancodes, so the layout follows the physical
+// keyboard rather than its character map.
 typedef struct {
-    SDL_Keycode key;
+    SDL_Scancode key;
     uint8_t value;
-    const char* label;
 } KeyMapping;
 
 // Controller 1 uses: LALT (A), LCTRL (B), 5 (Select), 1 (Start), arrows
 KeyMapping controller1Keys[] = {
-    { SDLK_LALT,   1,   "A" },
-    { SDLK_LCTRL,  2,   "B" },
-    { SDLK_5,      4,   "Select" },
-    { SDLK_1,      8,   "Start" },
-    { SDLK_UP,    16,   "Up" },
-    { SDLK_DOWN,  32,   "Down" },
-    { SDLK_LEFT,  64,   "Left" },
-    { SDLK_RIGHT,128,   "Right" }
+    { SDL_SCANCODE_LALT,  BUTTON_A },
+    { SDL_SCANCODE_LCTRL, BUTTON_B },
+    { SDL_SCANCODE_5,     BUTTON_SELECT },
+    { SDL_SCANCODE_1,     BUTTON_START },
+    { SDL_SCANCODE_UP,    BUTTON_UP },
+    { SDL_SCANCODE_DOWN,  BUTTON_DOWN },
+    { SDL_SCANCODE_LEFT,  BUTTON_LEFT },
+    { SDL_SCANCODE_RIGHT, BUTTON_RIGHT }
 };
 
 // Controller 2 uses: S (A), A (B), 6 (Select), 2 (Start), R/F/D/G for directions
 KeyMapping controller2Keys[] = {
-    { SDLK_s,      1,   "A" },
-    { SDLK_a,      2,   "B" },
-    { SDLK_6,      4,   "Select" },
-    { SDLK_2,      8,   "Start" },
-    { SDLK_r,     16,   "Up" },
-    { SDLK_f,     32,   "Down" },
-    { SDLK_d,     64,   "Left" },
-    { SDLK_g,    128,   "Right" }
+    { SDL_SCANCODE_S, BUTTON_A },
+    { SDL_SCANCODE_A, BUTTON_B },
+    { SDL_SCANCODE_6, BUTTON_SELECT },
+    { SDL_SCANCODE_2, BUTTON_START },
+    { SDL_SCANCODE_R, BUTTON_UP },
+    { SDL_SCANCODE_F, BUTTON_DOWN },
+    { SDL_SCANCODE_D, BUTTON_LEFT },
+    { SDL_SCANCODE_G, BUTTON_RIGHT }
 };
 
 #define NUM_KEYS 8
 
-bool keyState1[NUM_KEYS] = { false };
-bool keyState2[NUM_KEYS] = { false };
-
-// Audio control
-static double phase = 0.0; // Phase accumulator for waveform generation
-static uint32_t waveTimer = 0;
-static int volumeLevel = 0;
-static int semitoneStep = 0; // Tracks the semitone step (used for pitch shift)
+// The window runs as a two-stage pipeline. The emulation thread owns the
+// session, the audio producer side and the frame pacer, and hands finished
+// pictures to the main thread through a swap chain; the main thread owns SDL
+// events, the renderer and presentation. Neither waits for the other, so a
+// present that blocks on vsync or the compositor never delays emulation.
+// Everything below that both threads touch is atomic.
+static Input input;            // Main thread; its pad bytes are mirrored into padMask
+
+// Audio control. Everything but the ring is owned by the emulation thread.
+static AudioRing audioRing;    // Samples handed to the audio callback
+static RateControl rateControl; // Keeps the ring at its target depth
+
+// Text rendering
+static GlyphAtlas atlas;
+static Overlay overlay; // Retained text of the HUD
+static PerfHud hud;
+
+static Video video;     // Streaming texture the newest frame is uploaded to
+static SwapChain swapChain;
+static EmuContext emu;  // The session shown in the window
+static Rewind history;  // Its recent frames, for rewinding
+static RunAhead runAhead; // Shows its frames ahead; see --run-ahead
+static Movie movie;       // Its pads, recorded with --record or replayed into a --benchmark
+static bool recording = false;
+static bool replaying = false;
+static Netplay netplay;
+static bool netplayEnabled = false; // Inputs shared with a peer; see --netplay
+static Profile profile;        // Time per subsystem in a --benchmark run
+
+// Main thread to emulation thread
+static _Atomic uint16_t padMask;   // Held buttons, port 1 in the low byte and port 2 in the high
+static _Atomic bool rewinding;     // Rewind key held
+static _Atomic bool fastForward;   // Fast-forward key held
+static _Atomic bool stopEmulation;
+// Emulation thread to main thread
+static _Atomic bool emulationDone; // The loop has run its --frames
+
+static volatile sig_atomic_t stopRequested = 0;
 
 // Function declarations
-bool initSDL(SDL_Window** window, SDL_Renderer** renderer, TTF_Font** font, SDL_AudioDeviceID* audioDevice, SDL_AudioSpec* audioSpec);
+bool initSDL(SDL_Window** window, SDL_Renderer** renderer, GlyphAtlas* atlas, Overlay* overlay, Video* video, bool vsync, SDL_AudioDeviceID* audioDevice, SDL_AudioSpec* audioSpec);
 void handleEvents(SDL_Event* e, bool* running);
-void setKeyState(SDL_Keycode code, bool pressed);
-uint8_t getControllerState(bool* keyState, KeyMapping* keyMap);
-void renderText(SDL_Renderer* renderer, TTF_Font* font, const char* text, int x, int y, SDL_Color color);
-void renderDetailedInfo(SDL_Renderer* renderer, TTF_Font* font, uint8_t rawValue1, uint8_t rawValue2);
+void loadDefaultBindings(Input* input);
 void showMessageBox(const char* title, const char* message);
-
-// Square wave audio callback with phase accumulator to avoid clicking
-void squareWaveCallback(void* userdata, Uint8* stream, int len) {
+void printUsage(const char* program);
+void emulateFrame(double clockRate, bool ahead);
+int runHeadless(uint32_t maxFrames, int instances, int threads, const Cartridge* cart);
+int runReplay(uint32_t maxFrames, const Cartridge* cart);
+
+// Audio callback. Generation happens on the emulation side, so this only
+// drains the ring and runs in constant time. On an underrun the last sample is
+// held rather than dropping to zero, which would click.
+void audioCallback(void* userdata, Uint8* stream, int len) {
+    static int16_t lastSample = 0;
+    AudioRing* ring = (AudioRing*)userdata;
     int16_t* buffer = (int16_t*)stream;
     int numSamples = len / sizeof(int16_t);
 
-    // TODO: Update pitch calculation to match NES APU frequency register behavior
-    // NES pitch formula: Frequency = 1789773 / (16 * (N + 1))
-    // where N is the value loaded into the frequency register. Replace the current
-    // semitoneStep-based frequency scaling with an accurate calculation.
-    // Example adjustment:
-    // double frequency = calculateNESFrequency(semitoneStep);
-
-    // For now, using the base frequency (replace with NES frequency register calculation)
-    double frequency = BASE_FREQUENCY * pow(2.0, semitoneStep / 12.0);
-    double phaseInc = frequency / SAMPLE_RATE;
-
-    // TODO: Update volume calculation to reflect NES APU envelope behavior
-    // NES uses a 4-bit volume control (0-15) and an envelope generator for volume control
-    // Replace the current volumeLevel-based scaling with accurate NES envelope behavior
-    // Example: volumeLevel = calculateNESVolume(volumeLevel);
-    int16_t scaledAmplitude = (AMPLITUDE * volumeLevel) / (MAX_SEMITONE_STEPS - 1);
-
-    for (int i = 0; i < numSamples; ++i) {
-        buffer[i] = (phase < 0.5 ? scaledAmplitude : -scaledAmplitude);
-        phase += phaseInc;
-        if (phase >= 1.0) phase -= 1.0;
+    TRACE_THREAD("audio");
+    TRACE_SCOPE("audioCallback") {
+        int n = readAudioRing(ring, buffer, numSamples);
+        if (n > 0) lastSample = buffer[n - 1];
+        if (n < numSamples) {
+            for (int i = n; i < numSamples; ++i) buffer[i] = lastSample;
+            atomic_fetch_add_explicit(&ring->underruns, 1, memory_order_relaxed);
+        }
+    }
+}
+
+// Runs the session for one frame and queues the resulting samples. Emulation
+// thread.
+// `clockRate` is the CPU clock the audio is resampled from; `ahead` shows the
+// frame --run-ahead frames early when that is enabled.
+void emulateFrame(double clockRate, bool ahead) {
+    TRACE_SCOPE("emulateFrame") {
+        setBlipRates(&emu.blip, clockRate, updateRateControl(&rateControl, audioRingFill(&audioRing)));
+        int16_t samples[BLIP_MAX_SAMPLES];
+        int numSamples;
+        if (netplayEnabled) {
+            numSamples = advanceNetplay(&netplay, &emu, samples);
+        } else if (ahead && runAhead.frames > 0) {
+            numSamples = runAheadFrame(&runAhead, &emu, samples);
+        } else {
+            numSamples = runEmuFrame(&emu, samples);
+        }
+        // Whatever the path, the frame that just ran is now the session's
+        // last and ran with the pads it holds
+        if (recording && !netplayEnabled && !recordMovieFrame(&movie, emu.frames - 1, emu.nes.input)) {
+            SDL_Log("Out of memory; movie recording stopped at frame %u", movie.frames);
+            recording = false;
+        }
+        uint64_t start = beginProfile(emu.nes.profile);
+        writeAudioRing(&audioRing, samples, numSamples);
+        endProfile(emu.nes.profile, PROFILE_MIXING, start);
+    }
+}
+
+// One host frame of the session: takes the pads, emulates (or, in netplay,
+// waits out a frame the peer is too far behind for) and fills `out`. Returns
+// the number of frames emulated, 0 when no new picture was drawn.
+//
+// Fast-forward runs `skip` frames before the one that is shown, without
+// drawing; the PPU still runs its sprite 0 and vblank timing for them. Their
+// audio is decimated by the resampler, which is told the console clock is
+// `skip + 1` times faster, so a host frame yields one frame's worth of
+// samples and the ring keeps its depth. Ignored while rewinding and in
+// netplay, where the peer sets the pace.
+static int emulateHostFrame(SwapFrame* out, double clockRate, int skip) {
+    Profile* prof = emu.nes.profile;
+    uint16_t pads = replaying ? moviePads(&movie, emu.frames) : atomic_load_explicit(&padMask, memory_order_relaxed);
+    int frames = 1;
+
+    // The HUD shows the pads the frame runs with. It must not poll the ports
+    // itself: that would change their shift registers and the open bus, and
+    // with them what the game reads, so the session would no longer replay
+    // from its movie or stay in step with a netplay peer.
+    setPpuFramebuffer(&emu.nes.ppu, out->pixels, PPU_WIDTH);
+    if (netplayEnabled) {
+        // The local player uses the controller 1 keys whichever port they
+        // drive.
+        pollNetplay(&netplay, (uint8_t)pads);
+        frames = netplayCanAdvance(&netplay) ? 1 : 0;
+        if (frames > 0) emulateFrame(clockRate, false);
+        memcpy(out->pads, emu.nes.input, sizeof(out->pads));
+    } else {
+        uint64_t start = beginProfile(prof);
+        emu.nes.input[0] = (uint8_t)pads;
+        emu.nes.input[1] = (uint8_t)(pads >> 8);
+        memcpy(out->pads, emu.nes.input, sizeof(out->pads));
+        endProfile(prof, PROFILE_INPUT, start);
+
+        // Rewinding loads the previous frame's state and emulates the frame
+        // after it again, for the picture; those frames are not recorded twice
+        // and are shown as they were, not run ahead.
+        bool back = atomic_load_explicit(&rewinding, memory_order_relaxed);
+        if (back) {
+            stepRewind(&history, &emu);
+        } else if (skip > 0) {
+            clockRate *= skip + 1;
+            setPpuFramebuffer(&emu.nes.ppu, NULL, 0);
+            for (int i = 0; i < skip; ++i) {
+                emulateFrame(clockRate, false);
+                captureRewind(&history, &emu);
+            }
+            setPpuFramebuffer(&emu.nes.ppu, out->pixels, PPU_WIDTH);
+            frames += skip;
+        }
+        emulateFrame(clockRate, !back);
+        if (!back) captureRewind(&history, &emu);
+    }
+    setPpuFramebuffer(&emu.nes.ppu, NULL, 0);
+    out->emulatedFrames = emu.frames;
+    return frames;
+}
+
+typedef struct {
+    double frameRate;
+    double clockRate;
+    uint32_t maxFrames;    // Emulated frames to run, 0 until stopped
+    int fastForward;       // Frames per host frame while fast-forwarding, 0 for as many as fit
+    Uint64 frameTicks;     // Smoothed counter ticks one emulated frame takes
+    FramePacer pacer;      // Written by the thread, read after it is joined
+} EmulationLoop;
+
+// Frames to run undrawn before the shown one this host frame. Unthrottled
+// fast-forward fits as many as the measured frame cost allows into
+// FAST_FORWARD_BUDGET of the frame period, leaving the rest for the pacer's
+// slack, so its speed follows the emulation alone.
+static int fastForwardSkip(const EmulationLoop* loop) {
+    if (netplayEnabled || !atomic_load_explicit(&fastForward, memory_order_relaxed)) return 0;
+    if (loop->fastForward > 0) return loop->fastForward - 1;
+
+    Uint64 budget = (Uint64)(loop->pacer.period * FAST_FORWARD_BUDGET);
+    Uint64 frames = loop->frameTicks > 0 ? budget / loop->frameTicks : 1;
+    if (frames < 1) frames = 1;
+    if (frames > FAST_FORWARD_MAX_FRAMES) frames = FAST_FORWARD_MAX_FRAMES;
+    return (int)frames - 1;
+}
+
+// Emulation thread: paces frames on its own clock and publishes each picture.
+static void* runEmulationLoop(void* arg) {
+    EmulationLoop* loop = (EmulationLoop*)arg;
+    FramePacer* pacer = &loop->pacer;
+
+    TRACE_THREAD("emulation");
+    // --frames counts emulated frames, which fast-forward runs several of
+    // per host frame and netplay none of while it waits
+    while (!atomic_load(&stopEmulation) && (loop->maxFrames == 0 || emu.frames < loop->maxFrames)) {
+        SwapFrame* frame = swapChainBack(&swapChain);
+        int skip = fastForwardSkip(loop);
+        if (loop->maxFrames > 0 && skip > 0 && (uint32_t)skip >= loop->maxFrames - emu.frames) {
+            skip = (int)(loop->maxFrames - emu.frames - 1);
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        int frames = emulateHostFrame(frame, loop->clockRate, skip);
+        if (frames > 0) {
+            frame->hostFrames = pacer->frames;
+            frame->lateFrames = pacer->lateFrames;
+            publishSwapFrame(&swapChain);
+
+            // Rewinding ignores `skip`; the cost is per frame actually run
+            Uint64 ticks = (SDL_GetPerformanceCounter() - start) / (Uint64)frames;
+            loop->frameTicks = loop->frameTicks ? (loop->frameTicks * 7 + ticks) / 8 : ticks;
+        }
+        waitNextFrame(pacer);
+    }
+    atomic_store(&emulationDone, true);
+    return NULL;
+}
+
+// Uploads the newest frame, if there is one, and draws it with the HUD.
+// `shown` keeps the frame the HUD figures come from. Main thread.
+static void presentFrame(SDL_Renderer* renderer, const SwapFrame* frame, const SwapFrame** shown, Profile* prof) {
+
+    // The picture is stretched to the window by the GPU, the HUD drawn over it
+    uint64_t start = beginProfile(prof);
+    if (frame) {
+        uploadVideoFrame(&video, frame->pixels);
+        *shown = frame;
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    drawVideo(renderer, &video);
+    endProfile(prof, PROFILE_PRESENT, start);
+
+    start = beginProfile(prof);
+    const SwapFrame* f = *shown;
+    PerfCounters counters = {
+        f ? f->emulatedFrames : 0, f ? f->hostFrames : 0, f ? f->lateFrames : 0, audioRingFill(&audioRing),
+        atomic_load_explicit(&audioRing.underruns, memory_order_relaxed), { f ? f->pads[0] : 0, f ? f->pads[1] : 0 }
+    };
+    TRACE_SCOPE("renderPerfHud") renderPerfHud(renderer, &hud, &overlay, &atlas, &counters);
+    endProfile(prof, PROFILE_OVERLAY, start);
+
+    start = beginProfile(prof);
+    TRACE_SCOPE("SDL_RenderPresent") SDL_RenderPresent(renderer);
+    endProfile(prof, PROFILE_PRESENT, start);
+}
+
+static void requestStop(int signum) {
+    stopRequested = 1;
+}
+
+// One headless session and the memory its PPU draws into
+typedef struct {
+    EmuContext emu;
+    uint32_t framebuffer[PPU_WIDTH * PPU_HEIGHT];
+} HeadlessSession;
+
+typedef struct {
+    HeadlessSession* sessions;
+    uint32_t roundEnd;     // Frame count every session runs up to in this round
+} HeadlessRun;
+
+// Pool task: runs one session to the end of the round. Sessions share
+// nothing, so they need no locking; only the stop flag is read by all of them.
+static void runHeadlessSession(void* arg, int index) {
+    HeadlessRun* run = (HeadlessRun*)arg;
+    EmuContext* emu = &run->sessions[index].emu;
+    int16_t samples[BLIP_MAX_SAMPLES];
+
+    while (emu->frames < run->roundEnd && !stopRequested) {
+        runEmuFrame(emu, samples);
+    }
+}
+
+// Emulates frames back to back with no window, font or audio device, for
+// batch runs on servers. Pictures are still rendered, into memory, and audio
+// is still synthesized and then dropped, so a run costs what an interactive
+// one does minus presentation. `instances` independent sessions are spread
+// over `threads` threads. Each stops after `maxFrames` frames, or on SIGINT
+// or SIGTERM when that is 0. The pool steps all sessions in rounds of
+// HEADLESS_ROUND_FRAMES frames, so every one of them keeps running even when
+// there are more sessions than threads.
+int runHeadless(uint32_t maxFrames, int instances, int threads, const Cartridge* cart) {
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    HeadlessRun run = { calloc((size_t)instances, sizeof(HeadlessSession)), 0 };
+    ThreadPool pool;
+    if (!run.sessions || !initThreadPool(&pool, threads < instances ? threads : instances)) {
+        SDL_Log("Failed to set up %d sessions on %d threads", instances, threads);
+        free(run.sessions);
+        return 1;
+    }
+    for (int i = 0; i < instances; ++i) {
+        initEmuContext(&run.sessions[i].emu, SAMPLE_RATE, cart);
+        setPpuFramebuffer(&run.sessions[i].emu.nes.ppu, run.sessions[i].framebuffer, PPU_WIDTH);
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    while (!stopRequested && (maxFrames == 0 || run.roundEnd < maxFrames)) {
+        uint32_t left = maxFrames > 0 ? maxFrames - run.roundEnd : HEADLESS_ROUND_FRAMES;
+        run.roundEnd += left < HEADLESS_ROUND_FRAMES ? left : HEADLESS_ROUND_FRAMES;
+        runThreadPool(&pool, runHeadlessSession, &run, instances);
     }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
 
-    waveTimer += numSamples;
+    uint64_t frames = 0;
+    for (int i = 0; i < instances; ++i) frames += run.sessions[i].emu.frames;
+    SDL_Log("%llu frames in %.3f s (%.1f frames/s) over %d sessions",
+            (unsigned long long)frames, seconds, seconds > 0 ? frames / seconds : 0.0, instances);
 
-    // Update semitone and volume per frame
-    semitoneStep = (semitoneStep + 1) % MAX_SEMITONE_STEPS;
-    volumeLevel = (volumeLevel + 1) % MAX_SEMITONE_STEPS;
+    destroyThreadPool(&pool);
+    free(run.sessions);
+    return 0;
+}
+
+// Replays the movie from power-on with no window or audio device, up to its
+// end or `maxFrames` (when not 0), and writes each frame's number and picture
+// hash to stdout. A build or change that leaves emulation exact prints the
+// same lines.
+int runReplay(uint32_t maxFrames, const Cartridge* cart) {
+    static HeadlessSession session;
+    int16_t samples[BLIP_MAX_SAMPLES];
+    uint32_t frames = maxFrames > 0 && maxFrames < movie.frames ? maxFrames : movie.frames;
+
+    initEmuContext(&session.emu, SAMPLE_RATE, cart);
+    setPpuFramebuffer(&session.emu.nes.ppu, session.framebuffer, PPU_WIDTH);
+    for (uint32_t f = 0; f < frames; ++f) {
+        uint16_t pads = moviePads(&movie, f);
+        session.emu.nes.input[0] = (uint8_t)pads;
+        session.emu.nes.input[1] = (uint8_t)(pads >> 8);
+        runEmuFrame(&session.emu, samples);
+        printf("%u %016llx\n", f, (unsigned long long)hashFrame(session.framebuffer));
+    }
+    return fflush(stdout) == 0 ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
     SDL_Window* window = NULL;
     SDL_Renderer* renderer = NULL;
-    TTF_Font* font = NULL;
     SDL_AudioDeviceID audioDevice;
     SDL_AudioSpec audioSpec;
+    bool pal = false;
+    bool vsync = false;
+    int audioSamples = AUDIO_DEVICE_SAMPLES;
+    uint32_t maxFrames = 0;
+    bool headless = false;
+    bool benchmark = false;
+    int instances = 1;
+    int threads = 0;
+    const char* netplayPeer = NULL;
+    long netplayPort = 0;
+    int player = 1;
+    int aheadFrames = 0;
+    int fastForwardSpeed = 0;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* romPath = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--pal") == 0) {
+            pal = true;
+        } else if (strcmp(argv[i], "--vsync") == 0) {
+            vsync = true;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc && !romPath) {
+            benchmark = true;
+            romPath = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            long n = atol(argv[++i]);
+            if (n <= 0 || n > UINT32_MAX) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            maxFrames = (uint32_t)n;
+        } else if ((strcmp(argv[i], "--instances") == 0 || strcmp(argv[i], "--threads") == 0) && i + 1 < argc) {
+            int* count = argv[i][2] == 'i' ? &instances : &threads;
+            *count = atoi(argv[++i]);
+            if (*count < 1 || *count > 4096) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--netplay") == 0 && i + 2 < argc) {
+            netplayPort = atol(argv[++i]);
+            netplayPeer = argv[++i];
+            if (netplayPort <= 0 || netplayPort > 65535) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--player") == 0 && i + 1 < argc) {
+            player = atoi(argv[++i]);
+            if (player != 1 && player != 2) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc) {
+            audioSamples = atoi(argv[++i]);
+            if (audioSamples < 64 || audioSamples > 4096 || (audioSamples & (audioSamples - 1))) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            aheadFrames = atoi(argv[++i]);
+            if (aheadFrames < 1 || aheadFrames > RUN_AHEAD_MAX) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fast-forward") == 0 && i + 1 < argc) {
+            fastForwardSpeed = atoi(argv[++i]);
+            if (fastForwardSpeed < 2 || fastForwardSpeed > FAST_FORWARD_MAX) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (argv[i][0] != '-' && !romPath) {
+            romPath = argv[i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // A benchmark times the interactive frame loop, which has no netplay
+    if (benchmark && (headless || netplayPeer)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (benchmark && maxFrames == 0 && !replayPath) maxFrames = BENCHMARK_FRAMES;
+
+    // Run-ahead only changes what is presented, and netplay already runs
+    // frames against predicted input and rolls them back
+    if (aheadFrames > 0 && (headless || netplayPeer)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Movies are recorded from interactive play and replayed on their own or
+    // as a benchmark's input; netplay rolls inputs back after the fact
+    if ((recordPath && (headless || benchmark || replayPath || netplayPeer)) ||
+        (replayPath && (headless || netplayPeer))) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Every session inserts the same read-only cartridge
+    static Cartridge cartridge;
+    const Cartridge* cart = NULL;
+    if (romPath) {
+        const char* error;
+        if (!loadCartridge(&cartridge, romPath, &error)) {
+            fprintf(stderr, "%s: %s\n", romPath, error);
+            return 1;
+        }
+        if (!findMapper(cartridge.mapper)) {
+            fprintf(stderr, "%s: mapper %u is not supported\n", romPath, cartridge.mapper);
+            return 1;
+        }
+        cart = &cartridge;
+    }
+
+    if (replayPath) {
+        const char* error;
+        if (!loadMovie(&movie, replayPath, &error)) {
+            fprintf(stderr, "%s: %s\n", replayPath, error);
+            return 1;
+        }
+        if (movie.romHash != hashCartridge(cart)) {
+            fprintf(stderr, "%s: recorded on another ROM\n", replayPath);
+            return 1;
+        }
+        replaying = true;
+        if (!benchmark) {
+            int status = runReplay(maxFrames, cart);
+            destroyMovie(&movie);
+            unloadCartridge(&cartridge);
+            return status;
+        }
+        if (maxFrames == 0) maxFrames = movie.frames;
+    }
+    if (recordPath) {
+        initMovie(&movie, hashCartridge(cart));
+        recording = true;
+    }
+
+    if (headless) {
+        int status = runHeadless(maxFrames, instances, threads > 0 ? threads : countCpus(), cart);
+        unloadCartridge(&cartridge);
+        return status;
+    }
 
-    if (!initSDL(&window, &renderer, &font, &audioDevice, &audioSpec)) {
+    if (netplayPeer) {
+        if (!initNetplay(&netplay, (uint16_t)netplayPort, netplayPeer, player - 1)) {
+            fprintf(stderr, "Cannot reach %s from UDP port %ld\n", netplayPeer, netplayPort);
+            return 1;
+        }
+        netplayEnabled = true;
+    }
+
+    if (!initSDL(&window, &renderer, &atlas, &overlay, &video, vsync, &audioDevice, &audioSpec)) {
         showMessageBox("Error", "Failed to initialize SDL or TTF");
         return 1;
     }
 
-    audioSpec.freq = SAMPLE_RATE;
-    audioSpec.format = AUDIO_S16SYS;
-    audioSpec.channels = 1;
-    audioSpec.samples = 2048;
-    audioSpec.callback = squareWaveCallback;
-    audioSpec.userdata = NULL;
+    double frameRate = pal ? PAL_FRAME_RATE : NTSC_FRAME_RATE;
+
+    // Keep one device buffer plus one frame of audio queued: enough that the
+    // callback always finds a full buffer between two emulated frames.
+    int targetFill = audioSamples + (int)(SAMPLE_RATE / frameRate);
 
-    audioDevice = SDL_OpenAudioDevice(NULL, 0, &audioSpec, NULL, 0);
-    if (audioDevice == 0) {
-        showMessageBox("Error", "Failed to open audio device");
+    initAudioRing(&audioRing);
+    initRateControl(&rateControl, SAMPLE_RATE, targetFill);
+
+    initEmuContext(&emu, SAMPLE_RATE, cart);
+    initRunAhead(&runAhead, aheadFrames);
+    if (!initRewind(&history, REWIND_BUFFER_BYTES, (uint32_t)(frameRate * REWIND_SECONDS))) {
+        showMessageBox("Error", "Failed to allocate the rewind buffer");
         return 1;
     }
 
-    SDL_PauseAudioDevice(audioDevice, 0);
+    // A benchmark runs unpaced, so it has no audio device to keep fed; the
+    // loop drains the ring itself instead
+    audioDevice = 0;
+    if (!benchmark) {
+        audioSpec.freq = SAMPLE_RATE;
+        audioSpec.format = AUDIO_S16SYS;
+        audioSpec.channels = 1;
+        audioSpec.samples = (Uint16)audioSamples;
+        audioSpec.callback = audioCallback;
+        audioSpec.userdata = &audioRing;
+
+        audioDevice = SDL_OpenAudioDevice(NULL, 0, &audioSpec, NULL, 0);
+        if (audioDevice == 0) {
+            showMessageBox("Error", "Failed to open audio device");
+            return 1;
+        }
+
+        // Start at the target depth with silence so the first callbacks do not
+        // underrun before the first frames have been emulated.
+        static const int16_t silence[256];
+        while (audioRingFill(&audioRing) < targetFill) {
+            int n = targetFill - audioRingFill(&audioRing);
+            writeAudioRing(&audioRing, silence, n < 256 ? n : 256);
+        }
+        SDL_PauseAudioDevice(audioDevice, 0);
+    }
+
+    loadDefaultBindings(&input);
 
     SDL_Event e;
     bool running = true;
+    initPerfHud(&hud, frameRate);
+
+    // The machine always produces NTSC frames. Paced at another rate, its
+    // audio is resampled as if the console clock were scaled to match, so the
+    // ring neither floods nor starves.
+    EmulationLoop loop = {
+        .frameRate = frameRate,
+        .clockRate = APU_CLOCK_NTSC * frameRate / NTSC_FRAME_RATE,
+        .maxFrames = maxFrames,
+        .fastForward = fastForwardSpeed,
+    };
+
+    // The emulation pacer keeps the emulated rate even under --vsync, where
+    // presenting also waits for the display
+    initFramePacer(&loop.pacer, frameRate);
+    if (!initSwapChain(&swapChain)) {
+        showMessageBox("Error", "Failed to set up the frame swap chain");
+        return 1;
+    }
+    TRACE_THREAD("main");
+
+    if (benchmark) {
+        // A benchmark times both stages on this thread, one after the other,
+        // with no pacing. Sections are only timed here; elsewhere the
+        // brackets are no-ops.
+        emu.nes.profile = &profile;
+        uint64_t runStart = profileClock();
+        const SwapFrame* shown = NULL;
+
+        while (running && profile.frames < maxFrames) {
+            uint64_t start = profileClock();
+            TRACE_SCOPE("handleEvents") handleEvents(&e, &running);
+            endProfile(&profile, PROFILE_INPUT, start);
+
+            SwapFrame* frame = swapChainBack(&swapChain);
+            emulateHostFrame(frame, loop.clockRate, 0);
+            frame->hostFrames = profile.frames;
+            publishSwapFrame(&swapChain);
+            presentFrame(renderer, acquireSwapFrame(&swapChain, 0), &shown, &profile);
+            profile.frames++;
+
+            // Stand in for the audio callback
+            int16_t drained[BLIP_MAX_SAMPLES];
+            while (readAudioRing(&audioRing, drained, BLIP_MAX_SAMPLES) > 0) {}
+        }
 
-    while (running) {
-        handleEvents(&e, &running);
+        profile.totalNs = profileClock() - runStart;
+        printProfile(stderr, &profile, romPath);
+        writeProfileJson(stdout, &profile, romPath);
+    } else {
+        pthread_t emulationThread;
+        if (pthread_create(&emulationThread, NULL, runEmulationLoop, &loop) != 0) {
+            showMessageBox("Error", "Failed to start the emulation thread");
+            return 1;
+        }
 
-        uint8_t value1 = getControllerState(keyState1, controller1Keys);
-        uint8_t value2 = getControllerState(keyState2, controller2Keys);
+        // Presents whatever is newest; waits for the next frame when there is
+        // none yet, without ever holding up the emulation thread
+        const SwapFrame* shown = NULL;
+        while (running && !atomic_load(&emulationDone)) {
+            TRACE_SCOPE("handleEvents") handleEvents(&e, &running);
+            presentFrame(renderer, acquireSwapFrame(&swapChain, PRESENT_WAIT_MS), &shown, NULL);
+        }
 
-        renderDetailedInfo(renderer, font, value1, value2);
+        atomic_store(&stopEmulation, true);
+        pthread_join(emulationThread, NULL);
+    }
+    FramePacer pacer = loop.pacer;
 
-        SDL_Delay(1000 / 60); // 60 FPS
+    if (pacer.lateFrames > 0) {
+        SDL_Log("%u of %u frames missed their deadline", pacer.lateFrames, pacer.frames);
+    }
+    uint32_t underruns = atomic_load(&audioRing.underruns);
+    if (underruns > 0) {
+        SDL_Log("%u audio callbacks found the sample ring short", underruns);
     }
 
-    SDL_CloseAudioDevice(audioDevice);
-    TTF_CloseFont(font);
+    if (recordPath) {
+        const char* error;
+        if (saveMovie(&movie, recordPath, &error)) {
+            SDL_Log("Recorded %u frames to %s", movie.frames, recordPath);
+        } else {
+            SDL_Log("%s: %s", recordPath, error);
+        }
+    }
+    destroyMovie(&movie);
+
+    if (netplayEnabled) {
+        SDL_Log("Netplay: %u rollbacks re-simulated %u frames; waited for the peer %u times",
+                netplay.rollbacks, netplay.resimulated, netplay.stalls);
+        destroyNetplay(&netplay);
+    }
+
+    if (audioDevice != 0) SDL_CloseAudioDevice(audioDevice);
+    destroySwapChain(&swapChain);
+    destroyRewind(&history);
+    destroyOverlay(&overlay);
+    destroyVideo(&video);
+    destroyGlyphAtlas(&atlas);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
-    TTF_Quit();
     SDL_Quit();
+    unloadCartridge(&cartridge);
 
     return 0;
 }
 
-bool initSDL(SDL_Window** window, SDL_Renderer** renderer, TTF_Font** font, SDL_AudioDeviceID* audioDevice, SDL_AudioSpec* audioSpec) {
+bool initSDL(SDL_Window** window, SDL_Renderer** renderer, GlyphAtlas* atlas, Overlay* overlay, Video* video, bool vsync, SDL_AudioDeviceID* audioDevice, SDL_AudioSpec* audioSpec) {
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) return false;
     if (TTF_Init() == -1) return false;
 
     *window = SDL_CreateWindow("NES Controller and APU Test", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT, SDL_WINDOW_SHOWN);
     if (!*window) return false;
 
-    *renderer = SDL_CreateRenderer(*window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+    if (vsync) flags |= SDL_RENDERER_PRESENTVSYNC;
+    *renderer = SDL_CreateRenderer(*window, -1, flags);
     if (!*renderer) return false;
 
-    *font = TTF_OpenFont(FONT_PATH, FONT_SIZE);
-    if (!*font) return false;
+    if (!initVideo(video, *renderer)) return false;
+    if (!initOverlay(overlay, *renderer, WIDTH, HEIGHT)) return false;
+
+    // The font is only needed to rasterize the atlas; all text is drawn from the
+    // atlas texture afterwards, so TTF is shut down again right away.
+    TTF_Font* font = TTF_OpenFont(FONT_PATH, FONT_SIZE);
+    if (!font) return false;
 
-    return true;
+    bool ok = initGlyphAtlas(atlas, *renderer, font);
+    TTF_CloseFont(font);
+    TTF_Quit();
+
+    return ok;
 }
 
 void handleEvents(SDL_Event* e, bool* running) {
     while (SDL_PollEvent(e)) {
         if (e->type == SDL_QUIT) {
             *running = false;
+        } else if (e->type == SDL_RENDER_TARGETS_RESET) {
+            invalidateOverlay(&overlay);
         } else if (e->type == SDL_KEYDOWN || e->type == SDL_KEYUP) {
             bool pressed = (e->type == SDL_KEYDOWN);
-            setKeyState(e->key.keysym.sym, pressed);
+            handleInputKey(&input, e->key.keysym.scancode, pressed);
+            atomic_store_explicit(&padMask, (uint16_t)(input.state[0] | input.state[1] << 8), memory_order_relaxed);
+            if (e->key.keysym.scancode == REWIND_KEY) {
+                atomic_store_explicit(&rewinding, pressed, memory_order_relaxed);
+            }
+            if (e->key.keysym.scancode == FAST_FORWARD_KEY) {
+                atomic_store_explicit(&fastForward, pressed, memory_order_relaxed);
+            }
+            if (e->key.keysym.scancode == HUD_KEY && pressed && !e->key.repeat) {
+                hud.visible = !hud.visible;
+            }
+            if (e->key.keysym.scancode == TRACE_KEY && pressed && !e->key.repeat) {
+                if (TRACE_DUMP(TRACE_PATH)) SDL_Log("Trace written to %s", TRACE_PATH);
+            }
             if (e->key.keysym.sym == SDLK_ESCAPE) {
                 *running = false;
             }
@@ -182,85 +791,35 @@ void handleEvents(SDL_Event* e, bool* running) {
     }
 }
 
-void setKeyState(SDL_Keycode code, bool pressed) {
-    for (int i = 0; i < NUM_KEYS; ++i) {
-        if (controller1Keys[i].key == code) {
-            keyState1[i] = pressed;
-        }
-        if (controller2Keys[i].key == code) {
-            keyState2[i] = pressed;
-        }
-    }
-}
-
-uint8_t getControllerState(bool* keyState, KeyMapping* keyMap) {
-    uint8_t state = 0;
-    for (int i = 0; i < NUM_KEYS; ++i) {
-        if (keyState[i]) {
-            state |= keyMap[i].value;
-        }
-    }
-    return state;
-}
-
-void renderText(SDL_Renderer* renderer, TTF_Font* font, const char* text, int x, int y, SDL_Color color) {
-    SDL_Surface* surface = TTF_RenderText_Solid(font, text, color);
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    int w, h;
-    SDL_QueryTexture(texture, NULL, NULL, &w, &h);
-    SDL_Rect dst = { x, y, w, h };
-    SDL_RenderCopy(renderer, texture, NULL, &dst);
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
-}
-
-void renderDetailedInfo(SDL_Renderer* renderer, TTF_Font* font, uint8_t rawValue1, uint8_t rawValue2) {
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    SDL_Color white = { 255, 255, 255 };
-    SDL_Color green = { 0, 255, 0 };
-    SDL_Color red   = { 255, 0, 0 };
-
-    char bin1[9], bin2[9];
-    for (int i = 0; i < 8; ++i) {
-        bin1[i] = (rawValue1 & (1 << (7 - i))) ? '1' : '0';
-        bin2[i] = (rawValue2 & (1 << (7 - i))) ? '1' : '0';
-    }
-    bin1[8] = '\0';
-    bin2[8] = '\0';
-
-    renderText(renderer, font, "Controller 1:", 10, 10, white);
-    renderText(renderer, font, bin1, 200, 10, white);
-    renderText(renderer, font, "Controller 2:", 10, 30, white);
-    renderText(renderer, font, bin2, 200, 30, white);
-
-    int y = 60;
+void loadDefaultBindings(Input* input) {
+    initInput(input);
     for (int i = 0; i < NUM_KEYS; ++i) {
-        SDL_Color c1 = (rawValue1 & controller1Keys[i].value) ? green : red;
-        SDL_Color c2 = (rawValue2 & controller2Keys[i].value) ? green : red;
-
-        char label1[64], label2[64];
-        snprintf(label1, sizeof(label1), "C1 - %s: %s", controller1Keys[i].label, (c1.r == 0 ? "Pressed" : "Released"));
-        snprintf(label2, sizeof(label2), "C2 - %s: %s", controller2Keys[i].label, (c2.r == 0 ? "Pressed" : "Released"));
-
-        renderText(renderer, font, label1, 10, y, c1);
-        renderText(renderer, font, label2, WIDTH / 2, y, c2);
-        y += 20;
+        bindInput(input, controller1Keys[i].key, 0, controller1Keys[i].value);
+        bindInput(input, controller2Keys[i].key, 1, controller2Keys[i].value);
     }
-
-    char pitchText[64], volText[64];
-    double currentFreq = BASE_FREQUENCY * pow(2.0, semitoneStep / 12.0);
-    snprintf(pitchText, sizeof(pitchText), "Semitone Step: %d (%.2f Hz)", semitoneStep, currentFreq);
-    snprintf(volText, sizeof(volText), "Volume Level: %d / %d", volumeLevel, MAX_SEMITONE_STEPS - 1);
-
-    renderText(renderer, font, pitchText, WIDTH - 320, HEIGHT - 50, white);
-    renderText(renderer, font, volText, WIDTH - 320, HEIGHT - 30, white);
-    renderText(renderer, font, "Press ESC to quit", 10, HEIGHT - 30, white);
-
-    SDL_RenderPresent(renderer);
 }
 
 void showMessageBox(const char* title, const char* message) {
     SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, title, message, NULL);
 }
+
+void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] [rom.nes]\n"
+            "  --pal               Pace frames at the PAL rate (50.007 Hz) instead of NTSC (60.0988 Hz)\n"
+            "  --vsync             Present in step with the display's vertical sync\n"
+            "  --audio-buffer N    Audio device buffer in samples, a power of two (default %d)\n"
+            "  --headless          Run without window or audio, as fast as possible\n"
+            "  --benchmark ROM     Run ROM unpaced for --frames frames (default %d) and report where the time went\n"
+            "  --frames N          Exit after N frames\n"
+            "  --instances N       Headless sessions to run side by side (default 1)\n"
+            "  --threads N         Threads the headless sessions share (default: one per CPU)\n"
+            "  --netplay PORT HOST:PORT  Play against a peer over UDP, listening on PORT\n"
+            "  --player 1|2        Controller port the local player drives in netplay (default 1)\n"
+            "  --run-ahead N       Show frames N (1-%d) frames ahead to hide the game's input lag\n"
+            "  --fast-forward N    Run N (2-%d) times as fast while Tab is held (default: as fast as possible)\n"
+            "  --record FILE       Record both pads into an input movie\n"
+            "  --replay FILE       Replay a movie without window or audio and print each frame's picture hash;\n"
+            "                      with --benchmark, drive the benchmark with it\n",
+            program, AUDIO_DEVICE_SAMPLES, BENCHMARK_FRAMES, RUN_AHEAD_MAX, FAST_FORWARD_MAX);
+}
@@ -0,0 +1,20 @@
+#include "mapper.h"
+
+#include <stddef.h>
+
+extern const Mapper nromMapper;
+extern const Mapper mmc1Mapper;
+extern const Mapper uxromMapper;
+extern const Mapper cnromMapper;
+extern const Mapper mmc3Mapper;
+
+static const Mapper* const mappers[] = {
+    &nromMapper, &mmc1Mapper, &uxromMapper, &cnromMapper, &mmc3Mapper
+};
+
+const Mapper* findMapper(uint16_t number) {
+    for (size_t i = 0; i < sizeof(mappers) / sizeof(mappers[0]); ++i) {
+        if (mappers[i]->number == number) return mappers[i];
+    }
+    return NULL;
+}
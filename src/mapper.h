@@ -0,0 +1,64 @@
+#ifndef MAPPER_H
+#define MAPPER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bus.h"
+
+struct Nes;
+
+// Register files of the supported boards. They live in the Nes struct, so a
+// savestate captures them with everything else.
+typedef struct {
+    uint8_t bank;        // UxROM PRG or CNROM CHR bank
+} LatchRegisters;
+
+typedef struct {
+    uint8_t shift;       // Serial port: bits received so far, LSB first
+    uint8_t shiftCount;
+    uint8_t control;     // Mirroring, PRG and CHR modes
+    uint8_t chr0;
+    uint8_t chr1;
+    uint8_t prg;
+} Mmc1Registers;
+
+typedef struct {
+    uint8_t bankSelect;  // Target register and PRG/CHR modes
+    uint8_t banks[8];    // R0-R5 CHR, R6-R7 PRG
+    uint8_t irqLatch;
+    uint8_t irqCounter;
+    bool irqReload;
+    bool irqEnabled;
+    bool irqPending;
+    uint32_t seenClocks; // Ppu.a12Clocks the counter has been clocked up to
+} Mmc3Registers;
+
+typedef union {
+    LatchRegisters latch;
+    Mmc1Registers mmc1;
+    Mmc3Registers mmc3;
+} MapperRegisters;
+
+// A cartridge board. Banking only rewrites page tables: PRG windows point the
+// bus pages at other parts of the ROM image, CHR windows the PPU's pattern
+// pages, so reads never run mapper code. The board's registers are the write
+// handler of $8000-$FFFF.
+//
+// A board with an interrupt reports when it is due as an event, like the PPU
+// and APU do, instead of being clocked as the PPU runs.
+typedef struct {
+    uint16_t number;     // iNES mapper number
+    const char* name;
+    void (*reset)(struct Nes* nes);   // Power-on registers and banks
+    BusWriteFn write;                 // $8000-$FFFF; NULL for boards without registers
+    // Catches up with the PPU, drives IRQ_MAPPER and returns the PPU dot at
+    // which the interrupt is next raised, INT64_MAX if not. NULL when the
+    // board has no interrupt.
+    int64_t (*update)(struct Nes* nes);
+} Mapper;
+
+// The board for an iNES mapper number, or NULL when it is not supported.
+const Mapper* findMapper(uint16_t number);
+
+#endif
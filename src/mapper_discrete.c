@@ -0,0 +1,42 @@
+#include "nes.h"
+
+// Boards built from discrete logic: at most one latch, loaded by any write to
+// ROM space. Bus conflicts (the ROM driving the bus during the write) are not
+// emulated.
+
+// NROM (0): 16 or 32 KB of PRG, a 16 KB image mirrored at $C000
+static void resetNrom(Nes* nes) {
+    mapNesPrg(nes, 0x8000, 0x4000, 0);
+    mapNesPrg(nes, 0xC000, 0x4000, 1);
+}
+
+const Mapper nromMapper = { 0, "NROM", resetNrom, NULL, NULL };
+
+// UxROM (2): switchable 16 KB at $8000, the last bank fixed at $C000
+static void resetUxrom(Nes* nes) {
+    nes->mapperRegisters.latch.bank = 0;
+    mapNesPrg(nes, 0x8000, 0x4000, 0);
+    mapNesPrg(nes, 0xC000, 0x4000, -1);
+}
+
+static void writeUxrom(void* ctx, uint16_t addr, uint8_t value) {
+    Nes* nes = (Nes*)ctx;
+    nes->mapperRegisters.latch.bank = value;
+    mapNesPrg(nes, 0x8000, 0x4000, value);
+}
+
+const Mapper uxromMapper = { 2, "UxROM", resetUxrom, writeUxrom, NULL };
+
+// CNROM (3): NROM PRG with a switchable 8 KB CHR bank
+static void resetCnrom(Nes* nes) {
+    nes->mapperRegisters.latch.bank = 0;
+    resetNrom(nes);
+}
+
+static void writeCnrom(void* ctx, uint16_t addr, uint8_t value) {
+    Nes* nes = (Nes*)ctx;
+    nes->mapperRegisters.latch.bank = value;
+    mapNesChr(nes, 0, PPU_CHR_PAGES, value);
+}
+
+const Mapper cnromMapper = { 3, "CNROM", resetCnrom, writeCnrom, NULL };
@@ -0,0 +1,84 @@
+#include "nes.h"
+
+// MMC1 (1, SxROM). Registers are loaded through a 5-bit serial port: each
+// write to ROM space shifts in bit 0, and the fifth write stores the value in
+// the register its address selects ($8000 control, $A000 CHR 0, $C000 CHR 1,
+// $E000 PRG). A write with bit 7 set resets the port and selects PRG mode 3.
+// Writes on consecutive CPU cycles are not ignored as on hardware, and PRG-RAM
+// is always enabled.
+
+#define CONTROL_PRG_MODE 0x0C
+#define CONTROL_CHR_4K   0x10
+
+static const Mirroring mirrorings[4] = {
+    MIRROR_SINGLE_LOW, MIRROR_SINGLE_HIGH, MIRROR_VERTICAL, MIRROR_HORIZONTAL
+};
+
+static void applyMmc1(Nes* nes) {
+    const Mmc1Registers* r = &nes->mapperRegisters.mmc1;
+
+    // 512 KB boards (SUROM) take the upper PRG address bit from CHR 0
+    int banks = (int)(nes->cart->prgSize / 0x4000);
+    int outer = banks > 16 && (r->chr0 & 0x10) ? 16 : 0;
+    int last = outer + (banks > 16 ? 16 : banks) - 1;
+    int bank = outer | (r->prg & 0x0F);
+
+    switch ((r->control & CONTROL_PRG_MODE) >> 2) {
+    case 0:
+    case 1: // 32 KB
+        mapNesPrg(nes, 0x8000, 0x4000, bank & ~1);
+        mapNesPrg(nes, 0xC000, 0x4000, bank | 1);
+        break;
+    case 2: // First bank fixed at $8000
+        mapNesPrg(nes, 0x8000, 0x4000, outer);
+        mapNesPrg(nes, 0xC000, 0x4000, bank);
+        break;
+    default: // Last bank fixed at $C000
+        mapNesPrg(nes, 0x8000, 0x4000, bank);
+        mapNesPrg(nes, 0xC000, 0x4000, last);
+        break;
+    }
+
+    if (r->control & CONTROL_CHR_4K) {
+        mapNesChr(nes, 0, 4, r->chr0);
+        mapNesChr(nes, 4, 4, r->chr1);
+    } else {
+        mapNesChr(nes, 0, 8, r->chr0 >> 1);
+    }
+    setNesMirroring(nes, mirrorings[r->control & 3]);
+}
+
+static void resetMmc1(Nes* nes) {
+    Mmc1Registers* r = &nes->mapperRegisters.mmc1;
+    *r = (Mmc1Registers){ 0 };
+    r->control = CONTROL_PRG_MODE;
+    applyMmc1(nes);
+}
+
+static void writeMmc1(void* ctx, uint16_t addr, uint8_t value) {
+    Nes* nes = (Nes*)ctx;
+    Mmc1Registers* r = &nes->mapperRegisters.mmc1;
+
+    if (value & 0x80) {
+        r->shift = 0;
+        r->shiftCount = 0;
+        r->control |= CONTROL_PRG_MODE;
+        applyMmc1(nes);
+        return;
+    }
+
+    r->shift |= (uint8_t)((value & 1) << r->shiftCount);
+    if (++r->shiftCount < 5) return;
+
+    switch ((addr >> 13) & 3) {
+    case 0:  r->control = r->shift; break;
+    case 1:  r->chr0 = r->shift; break;
+    case 2:  r->chr1 = r->shift; break;
+    default: r->prg = r->shift; break;
+    }
+    r->shift = 0;
+    r->shiftCount = 0;
+    applyMmc1(nes);
+}
+
+const Mapper mmc1Mapper = { 1, "MMC1", resetMmc1, writeMmc1, NULL };
@@ -0,0 +1,106 @@
+#include "nes.h"
+
+// MMC3 (4, TxROM): 8 KB PRG and 1/2 KB CHR banks through a bank select and a
+// bank data register, plus the scanline counter. The counter is clocked by
+// rises of PPU address line A12, which the PPU counts itself (see
+// ppuA12ClockTime); the mapper catches up with that count whenever it is
+// consulted, and schedules the dot where the counter will reach zero as its
+// event, so nothing runs per scanline. PRG-RAM protection is not emulated.
+
+#define SELECT_REGISTER 0x07
+#define SELECT_PRG_SWAP 0x40 // $C000 switchable, $8000 fixed to the second last bank
+#define SELECT_CHR_SWAP 0x80 // 1 KB banks at $0000, 2 KB banks at $1000
+
+static void applyBanks(Nes* nes) {
+    const Mmc3Registers* r = &nes->mapperRegisters.mmc3;
+
+    bool prgSwap = r->bankSelect & SELECT_PRG_SWAP;
+    mapNesPrg(nes, prgSwap ? 0xC000 : 0x8000, 0x2000, r->banks[6]);
+    mapNesPrg(nes, 0xA000, 0x2000, r->banks[7]);
+    mapNesPrg(nes, prgSwap ? 0x8000 : 0xC000, 0x2000, -2);
+    mapNesPrg(nes, 0xE000, 0x2000, -1);
+
+    int low = r->bankSelect & SELECT_CHR_SWAP ? 4 : 0;
+    mapNesChr(nes, low, 2, r->banks[0] >> 1);
+    mapNesChr(nes, low + 2, 2, r->banks[1] >> 1);
+    for (int i = 0; i < 4; ++i) mapNesChr(nes, (low ^ 4) + i, 1, r->banks[2 + i]);
+}
+
+static void clockCounter(Mmc3Registers* r) {
+    if (r->irqCounter == 0 || r->irqReload) {
+        r->irqCounter = r->irqLatch;
+        r->irqReload = false;
+    } else {
+        r->irqCounter--;
+    }
+    if (r->irqCounter == 0 && r->irqEnabled) r->irqPending = true;
+}
+
+// Applies the A12 clocks the PPU has counted since the last call. The PPU
+// must have been caught up.
+static void syncCounter(Nes* nes) {
+    Mmc3Registers* r = &nes->mapperRegisters.mmc3;
+    for (; r->seenClocks != nes->ppu.a12Clocks; r->seenClocks++) clockCounter(r);
+
+    if (r->irqPending) {
+        nes->cpu.irq |= IRQ_MAPPER;
+    } else {
+        nes->cpu.irq &= ~IRQ_MAPPER;
+    }
+}
+
+static int64_t updateMmc3(Nes* nes) {
+    syncCounter(nes);
+
+    const Mmc3Registers* r = &nes->mapperRegisters.mmc3;
+    if (!r->irqEnabled || r->irqPending) return INT64_MAX;
+
+    // Clocks until the counter next reaches zero: a reload (or a counter at
+    // zero) takes one clock to load the latch, then the latch counts down
+    uint32_t clocks = r->irqCounter == 0 || r->irqReload ? 1u + r->irqLatch : r->irqCounter;
+    return ppuA12ClockTime(&nes->ppu, clocks);
+}
+
+static void resetMmc3(Nes* nes) {
+    Mmc3Registers* r = &nes->mapperRegisters.mmc3;
+    *r = (Mmc3Registers){ .banks = { 0, 2, 4, 5, 6, 7, 0, 1 } };
+    r->seenClocks = nes->ppu.a12Clocks;
+    applyBanks(nes);
+}
+
+static void writeMmc3(void* ctx, uint16_t addr, uint8_t value) {
+    Nes* nes = (Nes*)ctx;
+    Mmc3Registers* r = &nes->mapperRegisters.mmc3;
+    bool odd = addr & 1;
+
+    switch (addr & 0xE000) {
+    case 0x8000:
+        if (odd) {
+            r->banks[r->bankSelect & SELECT_REGISTER] = value;
+        } else {
+            r->bankSelect = value;
+        }
+        applyBanks(nes);
+        break;
+    case 0xA000:
+        if (!odd && nes->cart->mirroring != MIRROR_FOUR_SCREEN) {
+            setNesMirroring(nes, value & 1 ? MIRROR_HORIZONTAL : MIRROR_VERTICAL);
+        }
+        break;
+    default:
+        // Counter registers: apply the clocks that happened before this write
+        // first, and reschedule the interrupt after it
+        syncNesPpu(nes);
+        syncCounter(nes);
+        switch (addr & 0xE001) {
+        case 0xC000: r->irqLatch = value; break;
+        case 0xC001: r->irqCounter = 0; r->irqReload = true; break;
+        case 0xE000: r->irqEnabled = false; r->irqPending = false; break;
+        default:     r->irqEnabled = true; break;
+        }
+        updateNesMapper(nes);
+        break;
+    }
+}
+
+const Mapper mmc3Mapper = { 4, "MMC3", resetMmc3, writeMmc3, updateMmc3 };
@@ -0,0 +1,170 @@
+#include "movie.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET 0xCBF29CE484222325ull
+#define FNV_PRIME 0x100000001B3ull
+#define RUN_SIZE 4
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+void initMovie(Movie* movie, uint64_t romHash) {
+    memset(movie, 0, sizeof(*movie));
+    movie->romHash = romHash;
+}
+
+void destroyMovie(Movie* movie) {
+    free(movie->pads);
+    movie->pads = NULL;
+    movie->frames = movie->capacity = 0;
+}
+
+static bool reserveFrames(Movie* movie, uint32_t frames) {
+    if (frames <= movie->capacity) return true;
+    uint64_t capacity = movie->capacity ? movie->capacity : 4096;
+    while (capacity < frames) capacity *= 2;
+    if (capacity > UINT32_MAX) capacity = frames;
+    uint16_t* pads = realloc(movie->pads, sizeof(uint16_t) * capacity);
+    if (!pads) return false;
+    movie->pads = pads;
+    movie->capacity = (uint32_t)capacity;
+    return true;
+}
+
+bool recordMovieFrame(Movie* movie, uint32_t frame, const uint8_t pads[2]) {
+    if (frame == UINT32_MAX || !reserveFrames(movie, frame + 1)) return false;
+    // A frame past the end (never the case for a session recorded from
+    // power-on) leaves the gap without buttons
+    if (frame > movie->frames) memset(movie->pads + movie->frames, 0, sizeof(uint16_t) * (frame - movie->frames));
+    movie->pads[frame] = (uint16_t)(pads[0] | pads[1] << 8);
+    movie->frames = frame + 1;
+    return true;
+}
+
+bool saveMovie(const Movie* movie, const char* path, const char** error) {
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        *error = "cannot create the file";
+        return false;
+    }
+
+    // The run count goes into the header, so the runs are written first
+    uint8_t header[MOVIE_HEADER_SIZE] = { 0 };
+    bool ok = fwrite(header, 1, sizeof(header), out) == sizeof(header);
+    uint32_t runs = 0;
+    for (uint32_t f = 0; f < movie->frames && ok;) {
+        uint16_t pads = movie->pads[f];
+        uint32_t n = 1;
+        while (f + n < movie->frames && n < MOVIE_MAX_RUN && movie->pads[f + n] == pads) n++;
+
+        uint8_t run[RUN_SIZE];
+        put16(run, (uint16_t)n);
+        put16(run + 2, pads);
+        ok = fwrite(run, 1, sizeof(run), out) == sizeof(run);
+        runs++;
+        f += n;
+    }
+
+    memcpy(header, MOVIE_MAGIC, 4);
+    put16(header + 4, MOVIE_VERSION);
+    put32(header + 8, (uint32_t)movie->romHash);
+    put32(header + 12, (uint32_t)(movie->romHash >> 32));
+    put32(header + 16, movie->frames);
+    put32(header + 20, runs);
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), out) == sizeof(header);
+    ok = fclose(out) == 0 && ok;
+    if (!ok) *error = "write failed";
+    return ok;
+}
+
+bool loadMovie(Movie* movie, const char* path, const char** error) {
+    initMovie(movie, 0);
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        *error = "cannot open the file";
+        return false;
+    }
+
+    uint8_t header[MOVIE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), in) != sizeof(header) || memcmp(header, MOVIE_MAGIC, 4) != 0) {
+        fclose(in);
+        *error = "not a movie file";
+        return false;
+    }
+    if (get16(header + 4) != MOVIE_VERSION) {
+        fclose(in);
+        *error = "unsupported movie version";
+        return false;
+    }
+    movie->romHash = get32(header + 8) | (uint64_t)get32(header + 12) << 32;
+    uint32_t frames = get32(header + 16);
+    uint32_t runs = get32(header + 20);
+
+    // Check the counts against each other and the file before allocating
+    // anything for them
+    long size = fseek(in, 0, SEEK_END) == 0 ? ftell(in) : -1;
+    if (frames > (uint64_t)runs * MOVIE_MAX_RUN || runs > frames ||
+        size != MOVIE_HEADER_SIZE + (int64_t)runs * RUN_SIZE || fseek(in, MOVIE_HEADER_SIZE, SEEK_SET) != 0) {
+        fclose(in);
+        *error = "movie is truncated or corrupt";
+        return false;
+    }
+    if (frames > 0 && !reserveFrames(movie, frames)) {
+        fclose(in);
+        *error = "out of memory";
+        return false;
+    }
+    for (uint32_t r = 0; r < runs; ++r) {
+        uint8_t run[RUN_SIZE];
+        if (fread(run, 1, sizeof(run), in) != sizeof(run)) break;
+        uint32_t n = get16(run);
+        if (n == 0 || n > frames - movie->frames) break;
+        uint16_t pads = get16(run + 2);
+        for (uint32_t i = 0; i < n; ++i) movie->pads[movie->frames++] = pads;
+    }
+    fclose(in);
+
+    if (movie->frames != frames) {
+        destroyMovie(movie);
+        *error = "movie is truncated or corrupt";
+        return false;
+    }
+    return true;
+}
+
+uint64_t hashCartridge(const Cartridge* cart) {
+    if (!cart) return 0;
+    uint64_t h = FNV_OFFSET;
+    for (size_t i = 0; i < cart->imageSize; ++i) {
+        h = (h ^ cart->image[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+uint64_t hashFrame(const uint32_t* pixels) {
+    // A pixel at a time rather than a byte, a quarter of the multiplies;
+    // hashes are only ever compared with each other
+    uint64_t h = FNV_OFFSET;
+    for (int i = 0; i < PPU_WIDTH * PPU_HEIGHT; ++i) {
+        h = (h ^ pixels[i]) * FNV_PRIME;
+    }
+    return h;
+}
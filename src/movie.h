@@ -0,0 +1,60 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cartridge.h"
+
+#define MOVIE_MAGIC "VNMV"
+#define MOVIE_VERSION 1
+#define MOVIE_HEADER_SIZE 24
+#define MOVIE_MAX_RUN 0xFFFF // Frames one run record covers at most
+
+// Input movie: the buttons both pads held in every frame of a session, from
+// power-on. The machine is deterministic, so replaying a movie on the same
+// ROM and build reproduces the session frame for frame.
+//
+// A movie file is a header followed by run records, all little-endian:
+//
+//   0   "VNMV"
+//   4   u16 version (MOVIE_VERSION), u16 zero
+//   8   u64 ROM hash (hashCartridge)
+//   16  u32 frames, u32 run records
+//   24  per run: u16 frames (1-MOVIE_MAX_RUN), u8 port 1 pad, u8 port 2 pad
+//
+// Pads rarely change from one frame to the next, so an hour of play is a few
+// thousand records. Savestates hold host pointers and cannot be stored, so
+// every movie starts at power-on; the ROM hash stands in for the initial state.
+typedef struct {
+    uint64_t romHash;
+    uint16_t* pads;        // Per frame, port 1 in the low byte and port 2 in the high
+    uint32_t frames;
+    uint32_t capacity;
+} Movie;
+
+void initMovie(Movie* movie, uint64_t romHash);
+void destroyMovie(Movie* movie);
+
+// Records the pads frame `frame` ran with. Everything recorded after it is
+// dropped, so a session that rewinds records the frames it plays again over
+// the old ones. Returns false when out of memory.
+bool recordMovieFrame(Movie* movie, uint32_t frame, const uint8_t pads[2]);
+
+// Buttons of frame `frame`, none past the end
+static inline uint16_t moviePads(const Movie* movie, uint32_t frame) {
+    return frame < movie->frames ? movie->pads[frame] : 0;
+}
+
+// Writes or reads a movie file. On failure returns false and points `error`
+// at a description.
+bool saveMovie(const Movie* movie, const char* path, const char** error);
+bool loadMovie(Movie* movie, const char* path, const char** error);
+
+// FNV-1a of the whole ROM image, or 0 without a cartridge
+uint64_t hashCartridge(const Cartridge* cart);
+
+// FNV-1a over the pixels of a PPU_WIDTH x PPU_HEIGHT frame
+uint64_t hashFrame(const uint32_t* pixels);
+
+#endif
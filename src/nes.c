@@ -0,0 +1,294 @@
+#include "nes.h"
+
+#include <string.h>
+
+// Time within the current audio frame, as the APU counts it
+static inline int32_t nesTime(const Nes* nes) {
+    return (int32_t)(nes->cpu.cycles - nes->frameStart);
+}
+
+static inline int64_t ppuTime(const Nes* nes) {
+    return nes->cpu.cycles * PPU_DOTS_PER_CPU;
+}
+
+// First CPU cycle at or after PPU dot `dot`
+static inline int64_t cpuTimeOfDot(int64_t dot) {
+    return dot == INT64_MAX ? EVENT_NEVER : (dot + PPU_DOTS_PER_CPU - 1) / PPU_DOTS_PER_CPU;
+}
+
+// Moves one of the machine's events, ending the CPU's batch early when the
+// event is now due before the batch would have ended.
+static void scheduleNesEvent(Nes* nes, EventId id, int64_t time) {
+    scheduleEvent(&nes->events, id, time);
+    if (time < nes->cpu.deadline) nes->cpu.deadline = time;
+}
+
+// Passes a vblank NMI raised by the PPU on to the CPU.
+static inline void takePpuNmi(Nes* nes) {
+    if (nes->ppu.nmi) {
+        nes->ppu.nmi = false;
+        nes->cpu.nmi = true;
+    }
+}
+
+// Refreshes the APU's interrupt lines and reschedules its events, after
+// anything that may have changed them.
+static void updateNesApu(Nes* nes) {
+    Apu* apu = &nes->apu;
+
+    uint8_t irq = nes->cpu.irq & ~(IRQ_APU_FRAME | IRQ_APU_DMC);
+    if (apu->frameIrq) irq |= IRQ_APU_FRAME;
+    if (apu->dmcIrq) irq |= IRQ_APU_DMC;
+    nes->cpu.irq = irq;
+
+    int32_t fetch = apuDmcFetchTime(apu);
+    int32_t step = apuFrameIrqTime(apu);
+    scheduleNesEvent(nes, EVENT_DMC_FETCH, fetch == APU_NO_FETCH ? EVENT_NEVER : nes->frameStart + fetch);
+    scheduleNesEvent(nes, EVENT_APU_FRAME, step == INT32_MAX ? EVENT_NEVER : nes->frameStart + step);
+}
+
+void updateNesMapper(Nes* nes) {
+    if (!nes->mapper || !nes->mapper->update) return;
+    scheduleNesEvent(nes, EVENT_MAPPER_IRQ, cpuTimeOfDot(nes->mapper->update(nes)));
+}
+
+// Unconnected space: nothing drives the bus, so it keeps its last value
+static uint8_t readOpenBus(void* ctx, uint16_t addr) {
+    return ((Nes*)ctx)->bus.openBus;
+}
+
+static void writeNowhere(void* ctx, uint16_t addr, uint8_t value) {
+}
+
+// $2000-$3FFF: the eight PPU registers, mirrored
+static uint8_t readPpuRegister(void* ctx, uint16_t addr) {
+    Nes* nes = (Nes*)ctx;
+    uint64_t start = beginProfile(nes->profile);
+    uint8_t value = readPpu(&nes->ppu, ppuTime(nes), addr);
+    endProfile(nes->profile, PROFILE_PPU, start);
+    return value;
+}
+
+static void writePpuRegister(void* ctx, uint16_t addr, uint8_t value) {
+    Nes* nes = (Nes*)ctx;
+    uint64_t start = beginProfile(nes->profile);
+    writePpu(&nes->ppu, ppuTime(nes), addr, value);
+    endProfile(nes->profile, PROFILE_PPU, start);
+    // $2000 can raise NMI at once, and it and $2001 move the vblank and
+    // scanline counter events; the others cannot move an event
+    if ((addr & 7) <= 1) {
+        takePpuNmi(nes);
+        scheduleNesEvent(nes, EVENT_VBLANK, cpuTimeOfDot(ppuNextEvent(&nes->ppu)));
+        updateNesMapper(nes);
+    }
+}
+
+// Copies a CPU page to OAM through $2004 while the CPU is halted.
+static void runOamDma(Nes* nes, uint8_t page) {
+    uint64_t start = beginProfile(nes->profile);
+    for (int i = 0; i < 256; ++i) {
+        uint8_t value = readBus(&nes->bus, (uint16_t)(page << 8 | i));
+        writePpu(&nes->ppu, ppuTime(nes), 0x2004, value);
+    }
+    endProfile(nes->profile, PROFILE_PPU, start);
+    nes->cpu.cycles += OAM_DMA_STALL + (nes->cpu.cycles & 1);
+}
+
+// $4000-$43FF: APU and controller ports, open bus above $4017
+static uint8_t readIo(void* ctx, uint16_t addr) {
+    Nes* nes = (Nes*)ctx;
+    uint8_t openBus = nes->bus.openBus;
+
+    if (addr == 0x4015) {
+        // Bit 5 is not driven by the status register
+        uint64_t start = beginProfile(nes->profile);
+        uint8_t status = readApuStatus(&nes->apu, nes->blip, nesTime(nes));
+        endProfile(nes->profile, PROFILE_APU, start);
+        updateNesApu(nes);
+        return (uint8_t)((status & ~0x20) | (openBus & 0x20));
+    }
+    if (addr == 0x4016 || addr == 0x4017) {
+        return readControllerPort(&nes->ports, addr & 1, nes->input, openBus);
+    }
+    return openBus;
+}
+
+static void writeIo(void* ctx, uint16_t addr, uint8_t value) {
+    Nes* nes = (Nes*)ctx;
+
+    if (addr == 0x4014) {
+        runOamDma(nes, value);
+    } else if (addr == 0x4016) {
+        writeControllerStrobe(&nes->ports, value, nes->input);
+    } else if (addr <= 0x4017) {
+        uint64_t start = beginProfile(nes->profile);
+        writeApu(&nes->apu, nes->blip, nesTime(nes), addr, value);
+        endProfile(nes->profile, PROFILE_APU, start);
+        // DMC, status and frame counter writes can start a fetch, move the
+        // next frame step or change an interrupt line.
+        if (addr >= 0x4010) updateNesApu(nes);
+    }
+}
+
+static inline int wrapBank(int bank, size_t count) {
+    int n = (int)count;
+    return (bank % n + n) % n;
+}
+
+void mapNesPrg(Nes* nes, uint16_t addr, size_t size, int bank) {
+    const Cartridge* cart = nes->cart;
+    size_t offset = (size_t)wrapBank(bank, cart->prgSize / size) * size;
+    mapBusRom(&nes->bus, addr, size, cart->prg + offset);
+}
+
+void mapNesChr(Nes* nes, int page, int pages, int bank) {
+    const Cartridge* cart = nes->cart;
+    syncNesPpu(nes);
+    if (cart->chr) {
+        int first = wrapBank(bank, cart->chrSize / ((size_t)pages * PPU_CHR_PAGE_SIZE)) * pages;
+        for (int i = 0; i < pages; ++i) {
+            const uint8_t* mem = cart->chr + (size_t)(first + i) * PPU_CHR_PAGE_SIZE;
+            mapPpuChrRom(&nes->ppu, page + i, mem, &cart->chrCache[first + i]);
+        }
+    } else {
+        int first = wrapBank(bank, NES_CHR_RAM_SIZE / (pages * PPU_CHR_PAGE_SIZE)) * pages;
+        for (int i = 0; i < pages; ++i) {
+            int chrPage = first + i;
+            mapPpuChrRam(&nes->ppu, page + i, nes->chrRam + chrPage * PPU_CHR_PAGE_SIZE, &nes->chrCache[chrPage], chrPage);
+        }
+    }
+}
+
+void setNesMirroring(Nes* nes, Mirroring mirroring) {
+    syncNesPpu(nes);
+    for (int i = 0; i < 4; ++i) {
+        int table;
+        switch (mirroring) {
+        case MIRROR_HORIZONTAL:  table = i >> 1; break;
+        case MIRROR_SINGLE_LOW:  table = 0; break;
+        case MIRROR_SINGLE_HIGH: table = 1; break;
+        default:                 table = i & 1; break;
+        }
+        mapPpuNametable(&nes->ppu, i, nes->ppu.vram + table * 0x400);
+    }
+}
+
+// Maps the cartridge as the header describes it and lets its board set up
+// the power-on banks. Writes to ROM space go to the board's registers.
+static void mapCartridge(Nes* nes, const Cartridge* cart) {
+    const Mapper* mapper = findMapper(cart->mapper);
+    if (!mapper) return;
+    nes->mapper = mapper;
+
+    mapBusHandlers(&nes->bus, 0x8000, 0x8000, readOpenBus, mapper->write ? mapper->write : writeNowhere);
+    if (cart->prgRamSize > 0) mapBusRam(&nes->bus, 0x6000, NES_PRG_RAM_SIZE, nes->prgRam);
+    mapNesChr(nes, 0, PPU_CHR_PAGES, 0);
+    setNesMirroring(nes, cart->mirroring);
+    mapper->reset(nes);
+}
+
+void initNes(Nes* nes, BlipBuffer* blip, const Cartridge* cart) {
+    memset(nes, 0, sizeof(*nes));
+    nes->blip = blip;
+    nes->cart = cart;
+
+    initScheduler(&nes->events);
+    initBus(&nes->bus, nes, readOpenBus, writeNowhere);
+    for (uint16_t addr = 0; addr < 0x2000; addr += NES_RAM_SIZE) {
+        mapBusRam(&nes->bus, addr, NES_RAM_SIZE, nes->ram);
+    }
+    mapBusHandlers(&nes->bus, 0x2000, 0x2000, readPpuRegister, writePpuRegister);
+    mapBusHandlers(&nes->bus, 0x4000, BUS_PAGE_SIZE, readIo, writeIo);
+
+    initPpu(&nes->ppu);
+    for (int page = 0; page < PPU_CHR_PAGES; ++page) {
+        uint8_t* mem = nes->chrRam + page * PPU_CHR_PAGE_SIZE;
+        initTileCache(&nes->chrCache[page], mem, false);
+        mapPpuChrRam(&nes->ppu, page, mem, &nes->chrCache[page], page);
+    }
+    if (cart) mapCartridge(nes, cart);
+
+    initCpu(&nes->cpu, &nes->bus);
+    initApu(&nes->apu);
+    initControllerPorts(&nes->ports);
+    resetNes(nes);
+    scheduleNesEvent(nes, EVENT_VBLANK, cpuTimeOfDot(ppuNextEvent(&nes->ppu)));
+}
+
+void resetNes(Nes* nes) {
+    writeNes(nes, 0x4015, 0x00);
+    resetCpu(&nes->cpu);
+    updateNesMapper(nes);
+}
+
+// Brings the PPU up to the CPU and passes on a vblank NMI.
+void syncNesPpu(Nes* nes) {
+    uint64_t start = beginProfile(nes->profile);
+    runPpu(&nes->ppu, ppuTime(nes));
+    endProfile(nes->profile, PROFILE_PPU, start);
+    takePpuNmi(nes);
+}
+
+// Handles an event that has come due; each source reschedules its next one.
+static void runNesEvent(Nes* nes, EventId id) {
+    Apu* apu = &nes->apu;
+    uint64_t start;
+
+    switch (id) {
+    case EVENT_VBLANK:
+        syncNesPpu(nes);
+        scheduleNesEvent(nes, EVENT_VBLANK, cpuTimeOfDot(ppuNextEvent(&nes->ppu)));
+        break;
+    case EVENT_MAPPER_IRQ:
+        syncNesPpu(nes);
+        updateNesMapper(nes);
+        break;
+    case EVENT_DMC_FETCH:
+        start = beginProfile(nes->profile);
+        syncApu(apu, nes->blip, nesTime(nes));
+        if (apu->dmc.fetchTime <= nesTime(nes)) {
+            uint8_t value = readNes(nes, apu->dmc.address);
+            fillApuDmc(apu, nes->blip, nesTime(nes), value);
+            nes->cpu.cycles += DMC_FETCH_STALL;
+        }
+        updateNesApu(nes);
+        endProfile(nes->profile, PROFILE_APU, start);
+        break;
+    default:
+        start = beginProfile(nes->profile);
+        syncApu(apu, nes->blip, nesTime(nes));
+        updateNesApu(nes);
+        endProfile(nes->profile, PROFILE_APU, start);
+        break;
+    }
+}
+
+int32_t runNesFrame(Nes* nes) {
+    Cpu* cpu = &nes->cpu;
+    Profile* profile = nes->profile;
+    uint64_t start = beginProfile(profile);
+    uint64_t nested = profile ? profile->ns[PROFILE_PPU] + profile->ns[PROFILE_APU] : 0;
+
+    nes->ppu.frameDone = false;
+    while (!nes->ppu.frameDone) {
+        cpu->deadline = nextEventTime(&nes->events);
+        runCpu(cpu);
+        for (int id; (id = popDueEvent(&nes->events, cpu->cycles)) >= 0;) {
+            runNesEvent(nes, (EventId)id);
+        }
+    }
+
+    int32_t ran = nesTime(nes);
+    uint64_t apuStart = beginProfile(profile);
+    endApuFrame(&nes->apu, nes->blip, ran);
+    endProfile(profile, PROFILE_APU, apuStart);
+    nes->frameStart = cpu->cycles;
+
+    // The CPU is charged whatever the frame took beyond the PPU and APU work
+    // done within it
+    if (profile) {
+        nested = profile->ns[PROFILE_PPU] + profile->ns[PROFILE_APU] - nested;
+        profile->ns[PROFILE_CPU] += profileClock() - start - nested;
+    }
+    return ran;
+}
@@ -0,0 +1,102 @@
+#ifndef NES_H
+#define NES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "apu.h"
+#include "blip_buffer.h"
+#include "bus.h"
+#include "cartridge.h"
+#include "controller.h"
+#include "cpu.h"
+#include "input.h"
+#include "mapper.h"
+#include "ppu.h"
+#include "profile.h"
+#include "scheduler.h"
+
+#define NES_RAM_SIZE 0x800
+#define NES_PRG_RAM_SIZE 0x2000
+#define NES_CHR_RAM_SIZE 0x2000
+#define DMC_FETCH_STALL 4  // CPU cycles a DMC sample fetch steals
+#define OAM_DMA_STALL 513  // CPU cycles an OAM DMA steals, plus one on odd cycles
+#define PPU_DOTS_PER_CPU 3
+
+// The console around the CPU, run in catch-up fashion. Every component that
+// needs the CPU side at a set time (vblank, the board's interrupt, a DMC
+// fetch, a frame sequencer step that may interrupt) keeps one event in a
+// scheduler queue (see scheduler.h). The CPU executes in batches up to the
+// earliest event; the events then due are handled in time order, each
+// bringing its component up to date, refreshing its interrupt line and
+// scheduling its next event. A register access that can move an event
+// reschedules it at once, pulling in the end of the batch if it became
+// earlier, and PPU register accesses catch the PPU up to the access first.
+//
+// Work RAM is mapped straight into the bus page table, mirrored four times
+// over $0000-$1FFF; the $2000 and $4000 pages go to the PPU, APU and
+// controller handlers. The cartridge's PRG-ROM is mapped straight from its
+// image, as are its CHR-ROM pages and their shared tile caches into the PPU,
+// and PRG-RAM sits at $6000; the board's mapper (see mapper.h) switches banks
+// by remapping pages. Without a cartridge, cartridge space reads open bus and
+// the PPU sees 8 KB of CHR-RAM with vertical mirroring.
+typedef struct Nes {
+    Bus bus;
+    Cpu cpu;
+    Apu apu;
+    Ppu ppu;
+    ControllerPorts ports;
+    uint8_t input[INPUT_PORTS]; // Buttons held on each pad, as Input keeps them
+    MapperRegisters mapperRegisters;
+    int64_t frameStart;         // CPU cycle at which the current audio frame began
+    Scheduler events;
+    BlipBuffer* blip;
+    const Cartridge* cart;      // NULL when none is inserted
+    const Mapper* mapper;       // The cartridge's board, NULL without one
+    Profile* profile;           // Receives CPU, PPU and APU time when set
+    // Everything up to here is saved whole by a savestate, the memories
+    // below page by page; the tile caches are derived and not saved.
+    uint8_t ram[NES_RAM_SIZE];
+    uint8_t prgRam[NES_PRG_RAM_SIZE];
+    uint8_t chrRam[NES_CHR_RAM_SIZE];
+    TileCache chrCache[PPU_CHR_PAGES]; // Decoded CHR-RAM, rebuilt on demand
+} Nes;
+
+// Powers the machine on with `cart` inserted, or none when NULL. The cartridge's
+// mapper must be supported (see findMapper). Four-screen boards get vertical
+// mirroring, as the console has only 2 KB of nametable RAM.
+void initNes(Nes* nes, BlipBuffer* blip, const Cartridge* cart);
+void resetNes(Nes* nes);
+
+// Runs the machine until the PPU starts its next vblank, so the framebuffer
+// holds a whole frame, and ends the audio frame there. Returns the CPU cycles
+// run, 29780 or 29781 on NTSC.
+int32_t runNesFrame(Nes* nes);
+
+// Lets the board catch up and reschedules its interrupt event; for board
+// registers that move or acknowledge the interrupt.
+void updateNesMapper(Nes* nes);
+
+// Catches the PPU up with the CPU. Anything that changes what the PPU fetches
+// mid-frame must call it first, so pixels already due are drawn as they were.
+void syncNesPpu(Nes* nes);
+
+// Banking for mappers. Banks are numbered in units of the window size and
+// wrap around the ROM; negative numbers count from its end (-1 is the last).
+// CHR goes to CHR-RAM on boards without CHR-ROM. CHR and mirroring changes
+// catch the PPU up first.
+void mapNesPrg(Nes* nes, uint16_t addr, size_t size, int bank);
+void mapNesChr(Nes* nes, int page, int pages, int bank);
+void setNesMirroring(Nes* nes, Mirroring mirroring);
+
+// CPU bus accesses from the host, stamped at the current CPU time, for poking
+// registers between frames.
+static inline uint8_t readNes(Nes* nes, uint16_t addr) {
+    return readBus(&nes->bus, addr);
+}
+
+static inline void writeNes(Nes* nes, uint16_t addr, uint8_t value) {
+    writeBus(&nes->bus, addr, value);
+}
+
+#endif
@@ -0,0 +1,188 @@
+#include "netplay.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PACKET_MAGIC 0x564E  // "VN"
+#define PACKET_HEADER 11     // Magic, first frame, acknowledged frame, input count
+#define RING_MASK (NETPLAY_INPUT_RING - 1)
+#define STATE_SLOTS (NETPLAY_MAX_ROLLBACK + 1)
+
+_Static_assert((NETPLAY_INPUT_RING & RING_MASK) == 0, "NETPLAY_INPUT_RING must be a power of two");
+_Static_assert(NETPLAY_SEND_WINDOW + NETPLAY_MAX_ROLLBACK < NETPLAY_INPUT_RING, "input ring too small");
+
+static void put32(uint8_t* p, int32_t value) {
+    uint32_t v = (uint32_t)value;
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static int32_t get32(const uint8_t* p) {
+    return (int32_t)((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+}
+
+bool initNetplay(Netplay* net, uint16_t port, const char* peer, int localPort) {
+    memset(net, 0, sizeof(*net));
+    net->socket = -1;
+    net->localPort = localPort;
+    net->localFrame = -1;
+    net->remoteFrame = -1;
+    net->remoteAck = -1;
+    net->rollbackFrame = INT32_MAX;
+
+    // Split "host:port" at the last colon so IPv6 literals keep theirs
+    char host[256];
+    const char* colon = strrchr(peer, ':');
+    if (!colon || colon == peer || (size_t)(colon - peer) >= sizeof(host)) return false;
+    memcpy(host, peer, (size_t)(colon - peer));
+    host[colon - peer] = '\0';
+
+    struct addrinfo hints = { 0 };
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* found;
+    if (getaddrinfo(host, colon + 1, &hints, &found) != 0) return false;
+
+    memcpy(&net->peer, found->ai_addr, found->ai_addrlen);
+    net->peerLength = found->ai_addrlen;
+    int family = found->ai_family;
+    freeaddrinfo(found);
+
+    net->socket = socket(family, SOCK_DGRAM, 0);
+    if (net->socket < 0) return false;
+
+    struct sockaddr_storage local = { 0 };
+    socklen_t localLength;
+    if (family == AF_INET6) {
+        struct sockaddr_in6* in6 = (struct sockaddr_in6*)&local;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_addr = in6addr_any;
+        in6->sin6_port = htons(port);
+        localLength = sizeof(*in6);
+    } else {
+        struct sockaddr_in* in = (struct sockaddr_in*)&local;
+        in->sin_family = AF_INET;
+        in->sin_addr.s_addr = htonl(INADDR_ANY);
+        in->sin_port = htons(port);
+        localLength = sizeof(*in);
+    }
+    if (bind(net->socket, (struct sockaddr*)&local, localLength) != 0) {
+        destroyNetplay(net);
+        return false;
+    }
+    return true;
+}
+
+void destroyNetplay(Netplay* net) {
+    if (net->socket >= 0) close(net->socket);
+    net->socket = -1;
+}
+
+static void sendInputs(Netplay* net) {
+    uint8_t packet[PACKET_HEADER + NETPLAY_SEND_WINDOW];
+    int32_t first = net->remoteAck + 1;
+    if (first < net->localFrame - NETPLAY_SEND_WINDOW + 1) first = net->localFrame - NETPLAY_SEND_WINDOW + 1;
+    int count = net->localFrame - first + 1;
+    if (count < 0) count = 0;
+
+    packet[0] = PACKET_MAGIC >> 8;
+    packet[1] = PACKET_MAGIC & 0xFF;
+    put32(packet + 2, first);
+    put32(packet + 6, net->remoteFrame);
+    packet[10] = (uint8_t)count;
+    for (int i = 0; i < count; ++i) packet[PACKET_HEADER + i] = net->local[(first + i) & RING_MASK];
+
+    // Best effort: a dropped send is covered by the next one
+    sendto(net->socket, packet, PACKET_HEADER + count, 0, (struct sockaddr*)&net->peer, net->peerLength);
+}
+
+static void receiveInputs(Netplay* net) {
+    uint8_t packet[PACKET_HEADER + 255];
+
+    for (;;) {
+        ssize_t length = recvfrom(net->socket, packet, sizeof(packet), MSG_DONTWAIT, NULL, NULL);
+        if (length < 0) break;
+        if (length < PACKET_HEADER || packet[0] != PACKET_MAGIC >> 8 || packet[1] != (PACKET_MAGIC & 0xFF)) continue;
+        int count = packet[10];
+        if (length < PACKET_HEADER + count) continue;
+
+        int32_t first = get32(packet + 2);
+        int32_t ack = get32(packet + 6);
+        if (ack > net->remoteAck && ack <= net->localFrame) net->remoteAck = ack;
+
+        // Inputs are taken strictly in frame order; older ones are duplicates
+        for (int i = 0; i < count; ++i) {
+            int32_t f = first + i;
+            if (f != net->remoteFrame + 1) continue;
+            if (f > net->frame + NETPLAY_INPUT_RING - NETPLAY_SEND_WINDOW) break;
+
+            uint8_t value = packet[PACKET_HEADER + i];
+            net->remote[f & RING_MASK] = value;
+            if (f < net->frame && net->predicted[f & RING_MASK] != value && f < net->rollbackFrame) {
+                net->rollbackFrame = f;
+            }
+            net->remoteFrame = f;
+        }
+    }
+}
+
+void pollNetplay(Netplay* net, uint8_t input) {
+    if (net->localFrame < net->frame) {
+        net->localFrame = net->frame;
+        net->local[net->frame & RING_MASK] = input;
+    }
+    sendInputs(net);
+    receiveInputs(net);
+}
+
+bool netplayCanAdvance(Netplay* net) {
+    bool ready = net->frame - net->remoteFrame <= NETPLAY_MAX_ROLLBACK;
+    if (!ready) net->stalls++;
+    return ready;
+}
+
+// Sets both pads for frame f, predicting the peer's when it is not known yet.
+static void applyInputs(Netplay* net, EmuContext* emu, int32_t f) {
+    uint8_t remote;
+    if (f <= net->remoteFrame) {
+        remote = net->remote[f & RING_MASK];
+    } else {
+        remote = net->remoteFrame >= 0 ? net->remote[net->remoteFrame & RING_MASK] : 0;
+    }
+    net->predicted[f & RING_MASK] = remote;
+    emu->nes.input[net->localPort] = net->local[f & RING_MASK];
+    emu->nes.input[net->localPort ^ 1] = remote;
+}
+
+int advanceNetplay(Netplay* net, EmuContext* emu, int16_t* samples) {
+    if (net->rollbackFrame < net->frame) {
+        // Re-simulate without drawing; the audio of those frames has been
+        // played already and is dropped
+        Ppu* ppu = &emu->nes.ppu;
+        uint32_t* framebuffer = ppu->framebuffer;
+        int pitch = ppu->pitch;
+        setPpuFramebuffer(ppu, NULL, 0);
+
+        loadEmuState(emu, &net->states[net->rollbackFrame % STATE_SLOTS]);
+        for (int32_t f = net->rollbackFrame; f < net->frame; ++f) {
+            if (f != net->rollbackFrame) saveEmuState(emu, &net->states[f % STATE_SLOTS]);
+            applyInputs(net, emu, f);
+            runEmuFrame(emu, samples);
+        }
+        setPpuFramebuffer(ppu, framebuffer, pitch);
+
+        net->rollbacks++;
+        net->resimulated += (uint32_t)(net->frame - net->rollbackFrame);
+        net->rollbackFrame = INT32_MAX;
+    }
+
+    saveEmuState(emu, &net->states[net->frame % STATE_SLOTS]);
+    applyInputs(net, emu, net->frame);
+    int numSamples = runEmuFrame(emu, samples);
+    net->frame++;
+    return numSamples;
+}
@@ -0,0 +1,64 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "emu.h"
+
+#define NETPLAY_MAX_ROLLBACK 8  // Frames emulated ahead of the peer's input
+#define NETPLAY_INPUT_RING 64   // Frames of input kept per side; a power of two
+#define NETPLAY_SEND_WINDOW 32  // Unacknowledged local inputs resent in every packet
+
+// Two-player rollback netplay over UDP. Each side drives one controller port
+// and sends its pad byte for every frame to the peer; a packet carries every
+// input the peer has not acknowledged yet, so a lost packet is made up for by
+// the next one. The emulation never waits for the network: a frame whose
+// remote input has not arrived runs with a prediction (the peer's last known
+// buttons). When the actual input arrives and differs, the session is rolled
+// back to the state saved before the first mispredicted frame and
+// re-simulated up to the present within one host frame, without drawing.
+// Only when the peer falls NETPLAY_MAX_ROLLBACK frames behind does a side
+// stop to wait.
+//
+// Both sides start from power-on and must run the same build, as the machine
+// is deterministic but states are not exchanged.
+typedef struct {
+    int socket;
+    struct sockaddr_storage peer;
+    socklen_t peerLength;
+    int localPort;          // Controller port the local player drives
+    int32_t frame;          // Next frame to emulate
+    int32_t localFrame;     // Last frame with recorded local input, -1 before the first
+    int32_t remoteFrame;    // Last frame the peer's input is known for
+    int32_t remoteAck;      // Last local input the peer has confirmed
+    int32_t rollbackFrame;  // First frame run with a wrong prediction, or INT32_MAX
+    uint8_t local[NETPLAY_INPUT_RING];
+    uint8_t remote[NETPLAY_INPUT_RING];
+    uint8_t predicted[NETPLAY_INPUT_RING]; // Remote input each emulated frame ran with
+    EmuState states[NETPLAY_MAX_ROLLBACK + 1]; // Session state before each recent frame
+    uint32_t rollbacks;
+    uint32_t resimulated;   // Frames run again by rollbacks
+    uint32_t stalls;        // Host frames spent waiting for the peer
+} Netplay;
+
+// Listens on UDP `port` and exchanges inputs with `peer` ("host:port"). The
+// local player drives controller port `localPort` (0 or 1).
+bool initNetplay(Netplay* net, uint16_t port, const char* peer, int localPort);
+void destroyNetplay(Netplay* net);
+
+// Records the local pad for the next frame, unless it already is (the input
+// of a frame is fixed once it has been sent), sends the unacknowledged inputs
+// and takes in whatever the peer sent.
+void pollNetplay(Netplay* net, uint8_t input);
+
+// Whether the next frame may run, or the peer is too far behind.
+bool netplayCanAdvance(Netplay* net);
+
+// Rolls back and re-simulates if needed, then emulates the next frame and
+// reads its audio into `samples` (room for BLIP_MAX_SAMPLES). Returns the
+// number of samples.
+int advanceNetplay(Netplay* net, EmuContext* emu, int16_t* samples);
+
+#endif
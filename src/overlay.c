@@ -0,0 +1,86 @@
+#include "overlay.h"
+
+#include <string.h>
+
+bool initOverlay(Overlay* overlay, SDL_Renderer* renderer, int w, int h) {
+    memset(overlay, 0, sizeof(*overlay));
+    overlay->layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!overlay->layer) return false;
+    SDL_SetTextureBlendMode(overlay->layer, SDL_BLENDMODE_BLEND);
+    overlay->invalid = true;
+    return true;
+}
+
+void destroyOverlay(Overlay* overlay) {
+    if (overlay->layer) SDL_DestroyTexture(overlay->layer);
+    overlay->layer = NULL;
+}
+
+void setOverlayLine(Overlay* overlay, int index, int x, int y, const char* text, SDL_Color color) {
+    if (index < 0 || index >= OVERLAY_MAX_LINES) return;
+    OverlayLine* line = &overlay->lines[index];
+    if (index >= overlay->numLines) overlay->numLines = index + 1;
+
+    if (line->x == x && line->y == y && !memcmp(&line->color, &color, sizeof(color)) &&
+        strncmp(line->text, text, OVERLAY_LINE_LEN - 1) == 0) {
+        return;
+    }
+
+    // Lines are erased in place, so a line that moves forces a full rebuild.
+    if (line->drawnW > 0 && (line->x != x || line->y != y)) {
+        overlay->invalid = true;
+    }
+
+    strncpy(line->text, text, OVERLAY_LINE_LEN - 1);
+    line->text[OVERLAY_LINE_LEN - 1] = '\0';
+    line->color = color;
+    line->x = x;
+    line->y = y;
+    line->dirty = true;
+    overlay->dirty = true;
+}
+
+void invalidateOverlay(Overlay* overlay) {
+    overlay->invalid = true;
+}
+
+void renderOverlay(SDL_Renderer* renderer, Overlay* overlay, GlyphAtlas* atlas) {
+    if (overlay->dirty || overlay->invalid) {
+        SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+        SDL_BlendMode previousBlend;
+        SDL_GetRenderDrawBlendMode(renderer, &previousBlend);
+
+        SDL_SetRenderTarget(renderer, overlay->layer);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+
+        if (overlay->invalid) {
+            SDL_RenderClear(renderer);
+        } else {
+            // Erase every dirty line before drawing any, so a shorter line
+            // never clips a longer neighbour drawn in the same pass.
+            for (int i = 0; i < overlay->numLines; ++i) {
+                OverlayLine* line = &overlay->lines[i];
+                if (!line->dirty || line->drawnW == 0) continue;
+                SDL_Rect old = { line->x, line->y, line->drawnW, atlas->cellH };
+                SDL_RenderFillRect(renderer, &old);
+            }
+        }
+
+        for (int i = 0; i < overlay->numLines; ++i) {
+            OverlayLine* line = &overlay->lines[i];
+            if (!line->dirty && !overlay->invalid) continue;
+            renderText(renderer, atlas, line->text, line->x, line->y, line->color);
+            line->drawnW = (int)strlen(line->text) * atlas->cellW;
+            line->dirty = false;
+        }
+        flushText(renderer, atlas);
+
+        SDL_SetRenderDrawBlendMode(renderer, previousBlend);
+        SDL_SetRenderTarget(renderer, previousTarget);
+        overlay->dirty = false;
+        overlay->invalid = false;
+    }
+
+    SDL_RenderCopy(renderer, overlay->layer, NULL, NULL);
+}
@@ -0,0 +1,45 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#include "glyph_atlas.h"
+
+#define OVERLAY_MAX_LINES 32
+#define OVERLAY_LINE_LEN 64
+
+// One retained text line. The text is the cache key: setting the same text and
+// color again is a no-op and leaves the line clean.
+typedef struct {
+    char text[OVERLAY_LINE_LEN];
+    SDL_Color color;
+    int x, y;
+    int drawnW; // Width currently occupied on the layer, erased before a redraw
+    bool dirty;
+} OverlayLine;
+
+// Retained-mode text layer. All lines live in one render-target texture that is
+// only touched when a line changes, so an unchanged frame costs a single blit.
+// Lines must not overlap; a redraw only erases the line's own rectangle.
+typedef struct {
+    SDL_Texture* layer;
+    OverlayLine lines[OVERLAY_MAX_LINES];
+    int numLines;
+    bool dirty;   // At least one line needs redrawing
+    bool invalid; // Layer contents are undefined and must be rebuilt from scratch
+} Overlay;
+
+// The renderer must have been created with SDL_RENDERER_TARGETTEXTURE.
+bool initOverlay(Overlay* overlay, SDL_Renderer* renderer, int w, int h);
+void destroyOverlay(Overlay* overlay);
+
+void setOverlayLine(Overlay* overlay, int index, int x, int y, const char* text, SDL_Color color);
+
+// Call on SDL_RENDER_TARGETS_RESET, when the driver drops render-target contents.
+void invalidateOverlay(Overlay* overlay);
+
+// Redraws dirty lines into the layer, then copies the layer to the current target.
+void renderOverlay(SDL_Renderer* renderer, Overlay* overlay, GlyphAtlas* atlas);
+
+#endif
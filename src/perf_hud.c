@@ -0,0 +1,144 @@
+#include "perf_hud.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HUD_X 10
+#define HUD_Y 10
+#define HUD_LINE_HEIGHT 20
+#define HUD_COLUMNS 62  // Backdrop width in glyph cells, enough for the longest line
+#define GRAPH_HEIGHT 60 // Pixels for two frame periods
+#define GRAPH_GAP 4
+
+// Overlay line slots
+enum {
+    LINE_FPS,
+    LINE_FRAME_TIME,
+    LINE_AUDIO,
+    LINE_LATE,
+    LINE_PADS,
+    LINE_KEYS,
+    HUD_LINES
+};
+
+static const SDL_Color white = { 255, 255, 255, 255 };
+
+void initPerfHud(PerfHud* hud, double frameRate) {
+    hud->next = 0;
+    hud->count = 0;
+    hud->periodMs = (float)(1000.0 / frameRate);
+    hud->lastFrame = 0;
+    hud->refreshTicks = 0;
+    hud->refreshFrames = 0;
+    hud->sinceRefresh = PERF_HUD_REFRESH;
+    hud->visible = true;
+}
+
+static void recordFrame(PerfHud* hud, Uint64 now) {
+    if (hud->lastFrame != 0) {
+        hud->frameMs[hud->next] = (float)((now - hud->lastFrame) * 1000.0 / SDL_GetPerformanceFrequency());
+        hud->next = (hud->next + 1) % PERF_HUD_HISTORY;
+        if (hud->count < PERF_HUD_HISTORY) hud->count++;
+    }
+    hud->lastFrame = now;
+}
+
+static int compareFloats(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// Rewrites the figures from the history and the counters.
+static void refreshText(PerfHud* hud, Overlay* overlay, const PerfCounters* c, Uint64 now) {
+    char text[OVERLAY_LINE_LEN];
+
+    if (hud->refreshTicks != 0) {
+        double seconds = (double)(now - hud->refreshTicks) / SDL_GetPerformanceFrequency();
+        double fps = seconds > 0 ? (c->emulatedFrames - hud->refreshFrames) / seconds : 0.0;
+        snprintf(text, sizeof(text), "Emulated: %.1f fps", fps);
+        setOverlayLine(overlay, LINE_FPS, HUD_X, HUD_Y, text, white);
+    }
+    hud->refreshTicks = now;
+    hud->refreshFrames = c->emulatedFrames;
+
+    if (hud->count > 0) {
+        float sorted[PERF_HUD_HISTORY];
+        double sum = 0;
+        for (int i = 0; i < hud->count; ++i) {
+            sorted[i] = hud->frameMs[i];
+            sum += sorted[i];
+        }
+        qsort(sorted, (size_t)hud->count, sizeof(float), compareFloats);
+        int p99 = (hud->count * 99 + 99) / 100 - 1;
+        snprintf(text, sizeof(text), "Frame: min %.2f avg %.2f max %.2f p99 %.2f ms",
+                 sorted[0], sum / hud->count, sorted[hud->count - 1], sorted[p99]);
+        setOverlayLine(overlay, LINE_FRAME_TIME, HUD_X, HUD_Y + HUD_LINE_HEIGHT, text, white);
+    }
+
+    snprintf(text, sizeof(text), "Audio: %d samples queued, %u underruns", c->audioFill, c->underruns);
+    setOverlayLine(overlay, LINE_AUDIO, HUD_X, HUD_Y + 2 * HUD_LINE_HEIGHT, text, white);
+    snprintf(text, sizeof(text), "Late frames: %u of %u", c->lateFrames, c->hostFrames);
+    setOverlayLine(overlay, LINE_LATE, HUD_X, HUD_Y + 3 * HUD_LINE_HEIGHT, text, white);
+}
+
+// Bars of frame time, oldest on the left, over a line at one frame period.
+// Frames over one and a half periods are drawn red.
+static void drawGraph(SDL_Renderer* renderer, const PerfHud* hud, int x, int y) {
+    SDL_Rect fast[PERF_HUD_HISTORY], slow[PERF_HUD_HISTORY];
+    int numFast = 0, numSlow = 0;
+    float scale = GRAPH_HEIGHT / (2 * hud->periodMs);
+
+    for (int i = 0; i < hud->count; ++i) {
+        float ms = hud->frameMs[(hud->next - hud->count + i + PERF_HUD_HISTORY) % PERF_HUD_HISTORY];
+        int h = (int)(ms * scale + 0.5f);
+        if (h > GRAPH_HEIGHT) h = GRAPH_HEIGHT;
+        if (h < 1) h = 1;
+        SDL_Rect bar = { x + PERF_HUD_HISTORY - hud->count + i, y + GRAPH_HEIGHT - h, 1, h };
+        if (ms > 1.5f * hud->periodMs) {
+            slow[numSlow++] = bar;
+        } else {
+            fast[numFast++] = bar;
+        }
+    }
+
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    SDL_RenderFillRects(renderer, fast, numFast);
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    SDL_RenderFillRects(renderer, slow, numSlow);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDrawLine(renderer, x, y + GRAPH_HEIGHT / 2, x + PERF_HUD_HISTORY - 1, y + GRAPH_HEIGHT / 2);
+}
+
+void renderPerfHud(SDL_Renderer* renderer, PerfHud* hud, Overlay* overlay, GlyphAtlas* atlas, const PerfCounters* counters) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    recordFrame(hud, now);
+    if (++hud->sinceRefresh >= PERF_HUD_REFRESH) {
+        hud->sinceRefresh = 0;
+        refreshText(hud, overlay, counters, now);
+    }
+    if (!hud->visible) return;
+
+    char pads[OVERLAY_LINE_LEN];
+    char bits[2][9];
+    for (int port = 0; port < 2; ++port) {
+        for (int i = 0; i < 8; ++i) bits[port][i] = (counters->pads[port] & (0x80 >> i)) ? '1' : '0';
+        bits[port][8] = '\0';
+    }
+    snprintf(pads, sizeof(pads), "Pads: C1 %s  C2 %s", bits[0], bits[1]);
+    setOverlayLine(overlay, LINE_PADS, HUD_X, HUD_Y + 4 * HUD_LINE_HEIGHT, pads, white);
+    setOverlayLine(overlay, LINE_KEYS, HUD_X, HUD_Y + 5 * HUD_LINE_HEIGHT,
+                   "F1 hides this, Backspace rewinds, Tab fast-forwards, Esc quits", white);
+
+    // A translucent backdrop keeps the figures readable over any picture
+    int graphY = HUD_Y + HUD_LINES * HUD_LINE_HEIGHT + GRAPH_GAP;
+    SDL_Rect back = { HUD_X - 4, HUD_Y - 4, HUD_COLUMNS * atlas->cellW + 8, graphY + GRAPH_HEIGHT + 8 - HUD_Y };
+    SDL_BlendMode previousBlend;
+    SDL_GetRenderDrawBlendMode(renderer, &previousBlend);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &back);
+    SDL_SetRenderDrawBlendMode(renderer, previousBlend);
+
+    renderOverlay(renderer, overlay, atlas);
+    drawGraph(renderer, hud, HUD_X, graphY);
+}
@@ -0,0 +1,49 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "glyph_atlas.h"
+#include "overlay.h"
+
+#define PERF_HUD_HISTORY 240 // Host frames kept for the graph and statistics, one pixel each
+#define PERF_HUD_REFRESH 30  // Frames between refreshes of the figures
+
+// What the host loop measures elsewhere, handed to the HUD every frame
+typedef struct {
+    uint32_t emulatedFrames; // Frames the session has emulated so far
+    uint32_t hostFrames;     // Frames the host loop has run
+    uint32_t lateFrames;     // Of those, frames the pacer counted late
+    int audioFill;           // Samples queued for the audio callback
+    uint32_t underruns;      // Callbacks that found the ring short
+    uint8_t pads[2];         // Controller bytes as a game reads them
+} PerfCounters;
+
+// Performance HUD, drawn over the picture: emulated frame rate, host frame
+// time (min/avg/max/99th percentile over the last PERF_HUD_HISTORY frames,
+// plus a graph of them against the frame period), audio ring depth and
+// underruns, late frames and the pads. The text lives in a retained Overlay and
+// the figures change only every PERF_HUD_REFRESH frames, so most frames cost
+// one layer copy and two rectangle batches for the graph. Frame times are
+// recorded while the HUD is hidden too, so it shows a full history at once.
+typedef struct {
+    float frameMs[PERF_HUD_HISTORY]; // Ring of frame-to-frame intervals
+    int next;
+    int count;
+    float periodMs;           // Frame period the graph is scaled to
+    Uint64 lastFrame;         // Counter value at the previous frame, 0 before the first
+    Uint64 refreshTicks;      // Counter value and emulated frames at the last refresh
+    uint32_t refreshFrames;
+    int sinceRefresh;         // Frames since then; the first frame refreshes at once
+    bool visible;
+} PerfHud;
+
+void initPerfHud(PerfHud* hud, double frameRate);
+
+// Records the time since the previous call as a host frame and, when the HUD
+// is visible, draws it over the current render target.
+void renderPerfHud(SDL_Renderer* renderer, PerfHud* hud, Overlay* overlay, GlyphAtlas* atlas, const PerfCounters* counters);
+
+#endif
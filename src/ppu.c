@@ -0,0 +1,538 @@
+#include "ppu.h"
+
+#include <string.h>
+
+#define CTRL_INCREMENT_32 0x04
+#define CTRL_SPRITE_TABLE 0x08
+#define CTRL_BG_TABLE     0x10
+#define CTRL_SPRITE_16    0x20
+#define CTRL_NMI          0x80
+
+#define MASK_GREYSCALE    0x01
+#define MASK_BG_LEFT      0x02
+#define MASK_SPRITES_LEFT 0x04
+#define MASK_BG           0x08
+#define MASK_SPRITES      0x10
+#define MASK_RENDERING    (MASK_BG | MASK_SPRITES)
+
+#define STATUS_OVERFLOW   0x20
+#define STATUS_SPRITE0    0x40
+#define STATUS_VBLANK     0x80
+
+#define LINE_VBLANK    241
+#define LINE_PRERENDER 261
+
+#define BYTES_01 0x0101010101010101ull
+
+// 2C02 colours as ARGB8888
+static const uint32_t masterPalette[64] = {
+    0xFF666666, 0xFF002A88, 0xFF1412A7, 0xFF3B00A4, 0xFF5C007E, 0xFF6E0040, 0xFF6C0600, 0xFF561D00,
+    0xFF333500, 0xFF0B4800, 0xFF005200, 0xFF004F08, 0xFF00404D, 0xFF000000, 0xFF000000, 0xFF000000,
+    0xFFADADAD, 0xFF155FD9, 0xFF4240FF, 0xFF7527FE, 0xFFA01ACC, 0xFFB71E7B, 0xFFB53120, 0xFF994E00,
+    0xFF6B6D00, 0xFF388700, 0xFF0C9300, 0xFF008F32, 0xFF007C8D, 0xFF000000, 0xFF000000, 0xFF000000,
+    0xFFFFFEFF, 0xFF64B0FF, 0xFF9290FF, 0xFFC676FF, 0xFFF36AFF, 0xFFFE6ECC, 0xFFFE8170, 0xFFEA9E22,
+    0xFFBCBE00, 0xFF88D800, 0xFF5CE430, 0xFF45E082, 0xFF48CDDE, 0xFF4F4F4F, 0xFF000000, 0xFF000000,
+    0xFFFFFEFF, 0xFFC0DFFF, 0xFFD3D2FF, 0xFFE8C8FF, 0xFFFBC2FF, 0xFFFEC4EA, 0xFFFECCC5, 0xFFF7D8A5,
+    0xFFE4E594, 0xFFCFEF96, 0xFFBDF4AB, 0xFFB3F3CC, 0xFFB5EBF2, 0xFFB8B8B8, 0xFF000000, 0xFF000000
+};
+
+// Spreads a pattern byte over eight bytes, bit 7 (the leftmost pixel) into the
+// lowest-addressed byte on little-endian hosts, so two lookups OR'd together
+// decode a tile row.
+static const uint64_t bitSpread[256] = {
+    0x0000000000000000ull, 0x0100000000000000ull, 0x0001000000000000ull, 0x0101000000000000ull,
+    0x0000010000000000ull, 0x0100010000000000ull, 0x0001010000000000ull, 0x0101010000000000ull,
+    0x0000000100000000ull, 0x0100000100000000ull, 0x0001000100000000ull, 0x0101000100000000ull,
+    0x0000010100000000ull, 0x0100010100000000ull, 0x0001010100000000ull, 0x0101010100000000ull,
+    0x0000000001000000ull, 0x0100000001000000ull, 0x0001000001000000ull, 0x0101000001000000ull,
+    0x0000010001000000ull, 0x0100010001000000ull, 0x0001010001000000ull, 0x0101010001000000ull,
+    0x0000000101000000ull, 0x0100000101000000ull, 0x0001000101000000ull, 0x0101000101000000ull,
+    0x0000010101000000ull, 0x0100010101000000ull, 0x0001010101000000ull, 0x0101010101000000ull,
+    0x0000000000010000ull, 0x0100000000010000ull, 0x0001000000010000ull, 0x0101000000010000ull,
+    0x0000010000010000ull, 0x0100010000010000ull, 0x0001010000010000ull, 0x0101010000010000ull,
+    0x0000000100010000ull, 0x0100000100010000ull, 0x0001000100010000ull, 0x0101000100010000ull,
+    0x0000010100010000ull, 0x0100010100010000ull, 0x0001010100010000ull, 0x0101010100010000ull,
+    0x0000000001010000ull, 0x0100000001010000ull, 0x0001000001010000ull, 0x0101000001010000ull,
+    0x0000010001010000ull, 0x0100010001010000ull, 0x0001010001010000ull, 0x0101010001010000ull,
+    0x0000000101010000ull, 0x0100000101010000ull, 0x0001000101010000ull, 0x0101000101010000ull,
+    0x0000010101010000ull, 0x0100010101010000ull, 0x0001010101010000ull, 0x0101010101010000ull,
+    0x0000000000000100ull, 0x0100000000000100ull, 0x0001000000000100ull, 0x0101000000000100ull,
+    0x0000010000000100ull, 0x0100010000000100ull, 0x0001010000000100ull, 0x0101010000000100ull,
+    0x0000000100000100ull, 0x0100000100000100ull, 0x0001000100000100ull, 0x0101000100000100ull,
+    0x0000010100000100ull, 0x0100010100000100ull, 0x0001010100000100ull, 0x0101010100000100ull,
+    0x0000000001000100ull, 0x0100000001000100ull, 0x0001000001000100ull, 0x0101000001000100ull,
+    0x0000010001000100ull, 0x0100010001000100ull, 0x0001010001000100ull, 0x0101010001000100ull,
+    0x0000000101000100ull, 0x0100000101000100ull, 0x0001000101000100ull, 0x0101000101000100ull,
+    0x0000010101000100ull, 0x0100010101000100ull, 0x0001010101000100ull, 0x0101010101000100ull,
+    0x0000000000010100ull, 0x0100000000010100ull, 0x0001000000010100ull, 0x0101000000010100ull,
+    0x0000010000010100ull, 0x0100010000010100ull, 0x0001010000010100ull, 0x0101010000010100ull,
+    0x0000000100010100ull, 0x0100000100010100ull, 0x0001000100010100ull, 0x0101000100010100ull,
+    0x0000010100010100ull, 0x0100010100010100ull, 0x0001010100010100ull, 0x0101010100010100ull,
+    0x0000000001010100ull, 0x0100000001010100ull, 0x0001000001010100ull, 0x0101000001010100ull,
+    0x0000010001010100ull, 0x0100010001010100ull, 0x0001010001010100ull, 0x0101010001010100ull,
+    0x0000000101010100ull, 0x0100000101010100ull, 0x0001000101010100ull, 0x0101000101010100ull,
+    0x0000010101010100ull, 0x0100010101010100ull, 0x0001010101010100ull, 0x0101010101010100ull,
+    0x0000000000000001ull, 0x0100000000000001ull, 0x0001000000000001ull, 0x0101000000000001ull,
+    0x0000010000000001ull, 0x0100010000000001ull, 0x0001010000000001ull, 0x0101010000000001ull,
+    0x0000000100000001ull, 0x0100000100000001ull, 0x0001000100000001ull, 0x0101000100000001ull,
+    0x0000010100000001ull, 0x0100010100000001ull, 0x0001010100000001ull, 0x0101010100000001ull,
+    0x0000000001000001ull, 0x0100000001000001ull, 0x0001000001000001ull, 0x0101000001000001ull,
+    0x0000010001000001ull, 0x0100010001000001ull, 0x0001010001000001ull, 0x0101010001000001ull,
+    0x0000000101000001ull, 0x0100000101000001ull, 0x0001000101000001ull, 0x0101000101000001ull,
+    0x0000010101000001ull, 0x0100010101000001ull, 0x0001010101000001ull, 0x0101010101000001ull,
+    0x0000000000010001ull, 0x0100000000010001ull, 0x0001000000010001ull, 0x0101000000010001ull,
+    0x0000010000010001ull, 0x0100010000010001ull, 0x0001010000010001ull, 0x0101010000010001ull,
+    0x0000000100010001ull, 0x0100000100010001ull, 0x0001000100010001ull, 0x0101000100010001ull,
+    0x0000010100010001ull, 0x0100010100010001ull, 0x0001010100010001ull, 0x0101010100010001ull,
+    0x0000000001010001ull, 0x0100000001010001ull, 0x0001000001010001ull, 0x0101000001010001ull,
+    0x0000010001010001ull, 0x0100010001010001ull, 0x0001010001010001ull, 0x0101010001010001ull,
+    0x0000000101010001ull, 0x0100000101010001ull, 0x0001000101010001ull, 0x0101000101010001ull,
+    0x0000010101010001ull, 0x0100010101010001ull, 0x0001010101010001ull, 0x0101010101010001ull,
+    0x0000000000000101ull, 0x0100000000000101ull, 0x0001000000000101ull, 0x0101000000000101ull,
+    0x0000010000000101ull, 0x0100010000000101ull, 0x0001010000000101ull, 0x0101010000000101ull,
+    0x0000000100000101ull, 0x0100000100000101ull, 0x0001000100000101ull, 0x0101000100000101ull,
+    0x0000010100000101ull, 0x0100010100000101ull, 0x0001010100000101ull, 0x0101010100000101ull,
+    0x0000000001000101ull, 0x0100000001000101ull, 0x0001000001000101ull, 0x0101000001000101ull,
+    0x0000010001000101ull, 0x0100010001000101ull, 0x0001010001000101ull, 0x0101010001000101ull,
+    0x0000000101000101ull, 0x0100000101000101ull, 0x0001000101000101ull, 0x0101000101000101ull,
+    0x0000010101000101ull, 0x0100010101000101ull, 0x0001010101000101ull, 0x0101010101000101ull,
+    0x0000000000010101ull, 0x0100000000010101ull, 0x0001000000010101ull, 0x0101000000010101ull,
+    0x0000010000010101ull, 0x0100010000010101ull, 0x0001010000010101ull, 0x0101010000010101ull,
+    0x0000000100010101ull, 0x0100000100010101ull, 0x0001000100010101ull, 0x0101000100010101ull,
+    0x0000010100010101ull, 0x0100010100010101ull, 0x0001010100010101ull, 0x0101010100010101ull,
+    0x0000000001010101ull, 0x0100000001010101ull, 0x0001000001010101ull, 0x0101000001010101ull,
+    0x0000010001010101ull, 0x0100010001010101ull, 0x0001010001010101ull, 0x0101010001010101ull,
+    0x0000000101010101ull, 0x0100000101010101ull, 0x0001000101010101ull, 0x0101000101010101ull,
+    0x0000010101010101ull, 0x0100010101010101ull, 0x0001010101010101ull, 0x0101010101010101ull,
+};
+
+static void decodeTile(TileCache* cache, const uint8_t* chr, unsigned tile) {
+    const uint8_t* planes = chr + tile * 16;
+    for (int row = 0; row < 8; ++row) {
+        cache->rows[tile * 8 + row] = bitSpread[planes[row]] | bitSpread[planes[row + 8]] << 1;
+    }
+    cache->valid |= 1ull << tile;
+}
+
+void initTileCache(TileCache* cache, const uint8_t* chr, bool decodeNow) {
+    cache->valid = 0;
+    if (!decodeNow) return;
+    for (unsigned tile = 0; tile < PPU_TILES_PER_PAGE; ++tile) decodeTile(cache, chr, tile);
+}
+
+// Decoded row of the pattern byte pair at `addr` (tile * 16 + row)
+static inline uint64_t tileRow(Ppu* ppu, uint16_t addr) {
+    unsigned page = addr >> 10;
+    unsigned tile = (addr >> 4) & (PPU_TILES_PER_PAGE - 1);
+    TileCache* cache = ppu->chrCache[page];
+    if (!(cache->valid >> tile & 1)) decodeTile(cache, ppu->chr[page], tile);
+    return cache->rows[tile * 8 + (addr & 7)];
+}
+
+static inline bool renderingEnabled(const Ppu* ppu) {
+    return (ppu->mask & MASK_RENDERING) != 0;
+}
+
+static void refreshPalette(Ppu* ppu) {
+    uint8_t colours = ppu->mask & MASK_GREYSCALE ? 0x30 : 0x3F;
+    for (int i = 0; i < 32; ++i) ppu->paletteArgb[i] = masterPalette[ppu->palette[i] & colours];
+}
+
+// $3F10/$3F14/$3F18/$3F1C mirror the backdrop entries below them
+static inline unsigned paletteIndex(uint16_t addr) {
+    unsigned i = addr & 0x1F;
+    return (i & 0x13) == 0x10 ? i & 0x0F : i;
+}
+
+static uint8_t readVram(Ppu* ppu, uint16_t addr) {
+    addr &= 0x3FFF;
+    if (addr < 0x2000) return ppu->chr[addr >> 10][addr & 0x3FF];
+    if (addr < 0x3F00) return ppu->nametable[(addr >> 10) & 3][addr & 0x3FF];
+    return ppu->palette[paletteIndex(addr)];
+}
+
+static void writeVram(Ppu* ppu, uint16_t addr, uint8_t value) {
+    addr &= 0x3FFF;
+    if (addr < 0x2000) {
+        unsigned page = addr >> 10;
+        uint8_t* mem = ppu->chrWrite[page];
+        if (!mem) return;
+        mem[addr & 0x3FF] = value;
+        ppu->chrDirty |= 1u << (ppu->chrRamPage[page] << 2 | ((addr >> 8) & 3));
+        ppu->chrCache[page]->valid &= ~(1ull << ((addr >> 4) & (PPU_TILES_PER_PAGE - 1)));
+    } else if (addr < 0x3F00) {
+        ppu->nametable[(addr >> 10) & 3][addr & 0x3FF] = value;
+    } else {
+        unsigned i = paletteIndex(addr);
+        ppu->palette[i] = value & 0x3F;
+        ppu->paletteArgb[i] = masterPalette[ppu->palette[i] & (ppu->mask & MASK_GREYSCALE ? 0x30 : 0x3F)];
+    }
+}
+
+void initPpu(Ppu* ppu) {
+    memset(ppu, 0, sizeof(*ppu));
+    for (int i = 0; i < 4; ++i) mapPpuNametable(ppu, i, ppu->vram + (i & 1) * 0x400);
+    ppu->sprite0Start = ppu->sprite0End = 0;
+    ppu->compose = selectCompose(NULL);
+    refreshPalette(ppu);
+}
+
+void mapPpuChrRom(Ppu* ppu, int page, const uint8_t* mem, TileCache* cache) {
+    ppu->chr[page] = mem;
+    ppu->chrWrite[page] = NULL;
+    ppu->chrCache[page] = cache;
+}
+
+void mapPpuChrRam(Ppu* ppu, int page, uint8_t* mem, TileCache* cache, int ramPage) {
+    ppu->chr[page] = mem;
+    ppu->chrWrite[page] = mem;
+    ppu->chrCache[page] = cache;
+    ppu->chrRamPage[page] = (uint8_t)ramPage;
+}
+
+void mapPpuNametable(Ppu* ppu, int index, uint8_t* mem) {
+    ppu->nametable[index] = mem;
+}
+
+void setPpuFramebuffer(Ppu* ppu, uint32_t* pixels, int pitch) {
+    ppu->framebuffer = pixels;
+    ppu->pitch = pitch;
+}
+
+// Background pixels x0..x1-1 of the current line into bg, palette index or 0
+// where transparent. Tiles are addressed from v as it stood when the line's
+// fetches began.
+static void fetchBackground(Ppu* ppu, int x0, int x1, uint8_t* bg) {
+    uint8_t tiles[(PPU_WIDTH / 8 + 2) * 8];
+    uint16_t v = ppu->lineV;
+    int first = (x0 + ppu->fineX) >> 3;
+    int last = (x1 - 1 + ppu->fineX) >> 3;
+    uint16_t pattern = (uint16_t)((ppu->ctrl & CTRL_BG_TABLE) << 8 | v >> 12);
+    unsigned coarseY = (v >> 5) & 31;
+
+    for (int t = first; t <= last; ++t) {
+        unsigned coarseX = (v & 31) + t;
+        const uint8_t* nt = ppu->nametable[((v >> 10) & 3) ^ ((coarseX >> 5) & 1)];
+        coarseX &= 31;
+        uint8_t tile = nt[coarseY << 5 | coarseX];
+        uint8_t attr = nt[0x3C0 | (coarseY >> 2) << 3 | coarseX >> 2];
+        uint64_t palette = (attr >> ((coarseY & 2) << 1 | (coarseX & 2))) & 3;
+
+        // Give every opaque pixel of the row its palette bits, 8 at a time
+        uint64_t row = tileRow(ppu, (uint16_t)(pattern | tile << 4));
+        uint64_t opaque = ((row | row >> 1) & BYTES_01) * 0xFF;
+        row |= opaque & (palette << 2) * BYTES_01;
+        memcpy(&tiles[(t - first) * 8], &row, 8);
+    }
+    memcpy(bg, &tiles[(x0 + ppu->fineX) & 7], (size_t)(x1 - x0));
+}
+
+// Finds the sprites on `line`, at most eight in OAM order, and draws them into
+// the sprite line buffer with priority among them already resolved.
+static void evaluateSprites(Ppu* ppu, int line) {
+    memset(ppu->spriteLine, 0, sizeof(ppu->spriteLine));
+    ppu->sprite0Start = ppu->sprite0End = 0;
+    if (!renderingEnabled(ppu) || line >= PPU_HEIGHT) return;
+
+    int height = ppu->ctrl & CTRL_SPRITE_16 ? 16 : 8;
+    uint8_t found[8];
+    int count = 0;
+    for (int i = 0; i < 64; ++i) {
+        // OAM holds the line above the sprite's top
+        int row = line - 1 - ppu->oam[i * 4];
+        if ((unsigned)row >= (unsigned)height) continue;
+        if (count == 8) {
+            ppu->status |= STATUS_OVERFLOW;
+            break;
+        }
+        found[count++] = (uint8_t)i;
+    }
+
+    // Lower OAM indices win, so they are drawn last
+    for (int n = count - 1; n >= 0; --n) {
+        const uint8_t* sprite = &ppu->oam[found[n] * 4];
+        uint8_t tile = sprite[1], attr = sprite[2];
+        int x = sprite[3];
+        int row = line - 1 - sprite[0];
+        if (attr & 0x80) row = height - 1 - row;
+
+        uint16_t addr;
+        if (height == 16) {
+            addr = (uint16_t)((tile & 1) << 12 | (tile & 0xFE) << 4 | (row & 8) << 1 | (row & 7));
+        } else {
+            addr = (uint16_t)((ppu->ctrl & CTRL_SPRITE_TABLE) << 9 | tile << 4 | row);
+        }
+        uint64_t row8 = tileRow(ppu, addr);
+        if (attr & 0x40) row8 = __builtin_bswap64(row8);
+        uint8_t pixels[8];
+        memcpy(pixels, &row8, 8);
+
+        uint8_t flags = (uint8_t)(0x10 | (attr & 3) << 2);
+        if (attr & 0x20) flags |= SPRITE_BEHIND;
+        if (found[n] == 0) {
+            flags |= SPRITE_ZERO;
+            ppu->sprite0Start = (int16_t)x;
+            ppu->sprite0End = (int16_t)(x + 8 < PPU_WIDTH ? x + 8 : PPU_WIDTH);
+        }
+        for (int i = 0; i < 8 && x + i < PPU_WIDTH; ++i) {
+            if (pixels[i]) ppu->spriteLine[x + i] = flags | pixels[i];
+        }
+    }
+}
+
+// Draws pixels x0..x1-1 of the current line and detects a sprite 0 hit among them.
+static void renderSpan(Ppu* ppu, int x0, int x1) {
+    static const uint8_t noSprites[PPU_WIDTH];
+    uint32_t* out = ppu->framebuffer ? ppu->framebuffer + ppu->scanline * ppu->pitch : NULL;
+
+    if (!renderingEnabled(ppu)) {
+        if (out) {
+            for (int x = x0; x < x1; ++x) out[x] = ppu->paletteArgb[0];
+        }
+        return;
+    }
+
+    bool clipLeft = (ppu->mask & (MASK_BG_LEFT | MASK_SPRITES_LEFT)) != (MASK_BG_LEFT | MASK_SPRITES_LEFT);
+    int hitFrom = ppu->sprite0Start > x0 ? ppu->sprite0Start : x0;
+    int hitTo = ppu->sprite0End < x1 ? ppu->sprite0End : x1;
+    if (hitTo > PPU_WIDTH - 1) hitTo = PPU_WIDTH - 1; // Never at x = 255
+    if (clipLeft && hitFrom < 8) hitFrom = 8;
+    bool testHit = (ppu->mask & MASK_RENDERING) == MASK_RENDERING && !(ppu->status & STATUS_SPRITE0) &&
+                   hitFrom < hitTo;
+    if (!out && !testHit) return;
+
+    uint8_t bg[PPU_WIDTH];
+    if (ppu->mask & MASK_BG) {
+        fetchBackground(ppu, x0, x1, bg);
+        if (!(ppu->mask & MASK_BG_LEFT) && x0 < 8) memset(bg, 0, (size_t)((x1 < 8 ? x1 : 8) - x0));
+    } else {
+        memset(bg, 0, (size_t)(x1 - x0));
+    }
+
+    if (testHit) {
+        for (int x = hitFrom; x < hitTo; ++x) {
+            if ((ppu->spriteLine[x] & SPRITE_ZERO) && bg[x - x0]) {
+                ppu->status |= STATUS_SPRITE0;
+                break;
+            }
+        }
+    }
+    if (!out) return;
+
+    const uint8_t* sprites = ppu->mask & MASK_SPRITES ? ppu->spriteLine : noSprites;
+    int x = x0;
+    if (!(ppu->mask & MASK_SPRITES_LEFT) && x < 8) {
+        int end = x1 < 8 ? x1 : 8;
+        ppu->compose(out + x, bg, noSprites, end - x, ppu->paletteArgb);
+        x = end;
+    }
+    ppu->compose(out + x, bg + (x - x0), sprites + x, x1 - x, ppu->paletteArgb);
+}
+
+static void incrementY(Ppu* ppu) {
+    uint16_t v = ppu->v;
+    if ((v & 0x7000) != 0x7000) {
+        v += 0x1000;
+    } else {
+        v &= ~0x7000;
+        unsigned y = (v >> 5) & 31;
+        if (y == 29) {
+            y = 0;
+            v ^= 0x0800;
+        } else if (y == 31) {
+            y = 0;
+        } else {
+            y++;
+        }
+        v = (uint16_t)((v & ~0x03E0) | y << 5);
+    }
+    ppu->v = v;
+}
+
+// Dot of a rendered line at which A12 rises, or -1 when it stays low; see ppuA12ClockTime
+static inline int a12ClockDot(const Ppu* ppu) {
+    if (ppu->ctrl & (CTRL_SPRITE_TABLE | CTRL_SPRITE_16)) return 260;
+    return ppu->ctrl & CTRL_BG_TABLE ? 324 : -1;
+}
+
+// True when advancing from dot `from` to `to` executes dot `dot`
+static inline bool crosses(int from, int to, int dot) {
+    return from <= dot && dot < to;
+}
+
+// Runs dots from..to-1 of the current scanline.
+static void runLine(Ppu* ppu, int from, int to) {
+    int line = ppu->scanline;
+
+    if (line < PPU_HEIGHT) {
+        // Pixel x comes out at dot x + 1
+        int x0 = from > 1 ? from - 1 : 0;
+        int x1 = to < PPU_WIDTH + 1 ? to - 1 : PPU_WIDTH;
+        if (x1 > x0) renderSpan(ppu, x0, x1);
+    } else if (line == LINE_VBLANK) {
+        if (crosses(from, to, 1)) {
+            ppu->status |= STATUS_VBLANK;
+            ppu->frameDone = true;
+            ppu->frames++;
+            if (ppu->ctrl & CTRL_NMI) ppu->nmi = true;
+        }
+        return;
+    } else if (line == LINE_PRERENDER) {
+        if (crosses(from, to, 1)) ppu->status &= ~(STATUS_VBLANK | STATUS_SPRITE0 | STATUS_OVERFLOW);
+    } else {
+        return;
+    }
+
+    bool rendering = renderingEnabled(ppu);
+    if (rendering && crosses(from, to, 256)) incrementY(ppu);
+    if (crosses(from, to, 257)) {
+        if (rendering) ppu->v = (uint16_t)((ppu->v & ~0x041F) | (ppu->t & 0x041F));
+        evaluateSprites(ppu, line == LINE_PRERENDER ? 0 : line + 1);
+    }
+    if (rendering && crosses(from, to, a12ClockDot(ppu))) ppu->a12Clocks++;
+    if (rendering && line == LINE_PRERENDER && crosses(from, to, 280)) {
+        ppu->v = (uint16_t)((ppu->v & ~0x7BE0) | (ppu->t & 0x7BE0));
+    }
+    if (crosses(from, to, 321)) ppu->lineV = ppu->v;
+}
+
+void runPpu(Ppu* ppu, int64_t time) {
+    while (ppu->time < time) {
+        // Odd frames skip the last dot of the pre-render line while rendering
+        int lineDots = PPU_DOTS_PER_LINE;
+        if (ppu->scanline == LINE_PRERENDER && ppu->oddFrame && renderingEnabled(ppu)) lineDots--;
+
+        int from = ppu->dot;
+        int64_t left = time - ppu->time;
+        int to = left < lineDots - from ? from + (int)left : lineDots;
+        if (to > from) runLine(ppu, from, to);
+        ppu->time += to - from;
+
+        if (to < lineDots) {
+            ppu->dot = (int16_t)to;
+        } else {
+            ppu->dot = 0;
+            if (++ppu->scanline == PPU_LINES) {
+                ppu->scanline = 0;
+                ppu->oddFrame = !ppu->oddFrame;
+            }
+        }
+    }
+}
+
+uint8_t readPpu(Ppu* ppu, int64_t time, uint16_t addr) {
+    runPpu(ppu, time);
+
+    uint8_t value;
+    switch (addr & 7) {
+    case 2:
+        value = (uint8_t)((ppu->status & 0xE0) | (ppu->latch & 0x1F));
+        ppu->status &= ~STATUS_VBLANK;
+        ppu->writeToggle = false;
+        break;
+    case 4:
+        value = ppu->oam[ppu->oamAddr];
+        break;
+    case 7: {
+        uint16_t vramAddr = ppu->v & 0x3FFF;
+        if (vramAddr < 0x3F00) {
+            value = ppu->readBuffer;
+            ppu->readBuffer = readVram(ppu, vramAddr);
+        } else {
+            // Palette reads are immediate; the buffer gets the nametable byte underneath
+            value = (uint8_t)((ppu->latch & 0xC0) | ppu->palette[paletteIndex(vramAddr)]);
+            ppu->readBuffer = ppu->nametable[3][vramAddr & 0x3FF];
+        }
+        ppu->v = (ppu->v + (ppu->ctrl & CTRL_INCREMENT_32 ? 32 : 1)) & 0x7FFF;
+        break;
+    }
+    default:
+        value = ppu->latch;
+        break;
+    }
+    ppu->latch = value;
+    return value;
+}
+
+void writePpu(Ppu* ppu, int64_t time, uint16_t addr, uint8_t value) {
+    runPpu(ppu, time);
+    ppu->latch = value;
+
+    switch (addr & 7) {
+    case 0:
+        // Enabling NMI during vblank raises it at once
+        if (!(ppu->ctrl & CTRL_NMI) && (value & CTRL_NMI) && (ppu->status & STATUS_VBLANK)) ppu->nmi = true;
+        ppu->ctrl = value;
+        ppu->t = (uint16_t)((ppu->t & ~0x0C00) | (value & 3) << 10);
+        break;
+    case 1: {
+        bool greyChanged = (ppu->mask ^ value) & MASK_GREYSCALE;
+        ppu->mask = value;
+        if (greyChanged) refreshPalette(ppu);
+        break;
+    }
+    case 3:
+        ppu->oamAddr = value;
+        break;
+    case 4:
+        ppu->oam[ppu->oamAddr++] = value;
+        break;
+    case 5:
+        if (!ppu->writeToggle) {
+            ppu->t = (uint16_t)((ppu->t & ~0x001F) | value >> 3);
+            ppu->fineX = value & 7;
+        } else {
+            ppu->t = (uint16_t)((ppu->t & ~0x73E0) | (value & 0xF8) << 2 | (value & 7) << 12);
+        }
+        ppu->writeToggle = !ppu->writeToggle;
+        break;
+    case 6:
+        if (!ppu->writeToggle) {
+            ppu->t = (uint16_t)((ppu->t & 0x00FF) | (value & 0x3F) << 8);
+        } else {
+            ppu->t = (uint16_t)((ppu->t & 0xFF00) | value);
+            ppu->v = ppu->t;
+        }
+        ppu->writeToggle = !ppu->writeToggle;
+        break;
+    case 7:
+        writeVram(ppu, ppu->v, value);
+        ppu->v = (ppu->v + (ppu->ctrl & CTRL_INCREMENT_32 ? 32 : 1)) & 0x7FFF;
+        break;
+    default:
+        break;
+    }
+}
+
+int64_t ppuNextEvent(const Ppu* ppu) {
+    // The vblank flag is visible once dot 1 of the vblank line has run
+    int lines = LINE_VBLANK - ppu->scanline;
+    if (lines < 0 || (lines == 0 && ppu->dot > 1)) lines += PPU_LINES;
+    return ppu->time - ppu->dot + (int64_t)lines * PPU_DOTS_PER_LINE + 2;
+}
+
+int64_t ppuA12ClockTime(const Ppu* ppu, uint32_t n) {
+    int dot = a12ClockDot(ppu);
+    if (!renderingEnabled(ppu) || dot < 0 || n == 0) return INT64_MAX;
+
+    // Walk the rendered lines from the current one; a line's clock is past
+    // once its dot has run
+    int line = ppu->scanline;
+    int64_t lineStart = ppu->time - ppu->dot;
+    if (ppu->dot > dot) {
+        line++;
+        lineStart += PPU_DOTS_PER_LINE;
+    }
+    for (;;) {
+        if (line == PPU_LINES) line = 0;
+        if (line < PPU_HEIGHT || line == LINE_PRERENDER) {
+            if (--n == 0) return lineStart + dot + 1;
+            line++;
+            lineStart += PPU_DOTS_PER_LINE;
+        } else {
+            // Post-render and vblank lines never clock
+            lineStart += (int64_t)(LINE_PRERENDER - line) * PPU_DOTS_PER_LINE;
+            line = LINE_PRERENDER;
+        }
+    }
+}
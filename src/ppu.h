@@ -0,0 +1,133 @@
+#ifndef PPU_H
+#define PPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "compose.h"
+
+#define PPU_WIDTH 256
+#define PPU_HEIGHT 240
+#define PPU_DOTS_PER_LINE 341
+#define PPU_LINES 262     // 240 visible, post-render, 20 of vblank, pre-render
+#define PPU_CHR_PAGES 8   // 1 KB pattern memory pages, like the bus pages
+#define PPU_CHR_PAGE_SIZE 0x400
+#define PPU_TILES_PER_PAGE 64
+
+// Sprite line buffer entries: palette index 0x10-0x1F, or 0 where no sprite
+// is opaque, plus the priority and sprite 0 flags.
+#define SPRITE_COLOR  0x1F
+#define SPRITE_BEHIND 0x20 // Drawn behind opaque background
+#define SPRITE_ZERO   0x40
+
+// Pattern rows of one 1 KB CHR page, pre-decoded: each tile row is 8 bytes,
+// leftmost pixel first, each holding that pixel's 2-bit colour. A set bit in
+// `valid` marks a tile whose rows are current. CHR-ROM caches are decoded once
+// when loaded; CHR-RAM caches decode on first use and a write only clears the
+// bit of the tile it lands in.
+typedef struct {
+    uint64_t rows[PPU_TILES_PER_PAGE * 8];
+    uint64_t valid;
+} TileCache;
+
+// Decodes `chr` into `cache` now, or marks every tile stale so it is decoded on use.
+void initTileCache(TileCache* cache, const uint8_t* chr, bool decodeNow);
+
+// 2C02 PPU, rendered in spans rather than dots. The PPU runs lazily like the
+// APU: it catches up to the CPU when a register is accessed or an event is
+// due, and a catch-up draws every pixel the elapsed dots cover with the
+// register state of the moment. With no mid-line access that is one span per
+// scanline; a mid-line write splits the line at the dot where it lands, so
+// raster effects still land on the right pixel.
+//
+// Each visible line is composed from a background span, fetched a tile row at
+// a time from the tile caches, and a sprite line buffer that is evaluated and
+// priority-resolved once per line, at dot 257 of the line before it. The merge
+// and the palette lookup run as one SIMD pass (see compose.h). Scrolling
+// follows the loopy v/t registers at the dots real hardware updates them (Y
+// increment at 256, horizontal copy at 257, vertical copy on the pre-render
+// line, first fetch at 321); writes to v while a line is being fetched take
+// effect on the next line. Colour emphasis is not emulated.
+//
+// Times are PPU dots since power-on, three per CPU cycle.
+typedef struct {
+    // Registers
+    uint8_t ctrl;          // $2000
+    uint8_t mask;          // $2001
+    uint8_t status;        // $2002: vblank, sprite 0 hit, sprite overflow
+    uint8_t oamAddr;       // $2003
+    uint16_t v;            // Current VRAM address
+    uint16_t t;            // Temporary VRAM address
+    uint8_t fineX;
+    bool writeToggle;      // The shared $2005/$2006 first/second write latch
+    uint8_t readBuffer;    // $2007 read delay buffer
+    uint8_t latch;         // Value last written to any register, read back from write-only ones
+    bool nmi;              // NMI raised, waiting for the CPU side to take it
+    bool frameDone;        // Set when a frame's vblank begins
+
+    // Memory. Pattern pages and nametables point into cartridge or console
+    // memory; pages without a write pointer ignore writes.
+    const uint8_t* chr[PPU_CHR_PAGES];
+    uint8_t* chrWrite[PPU_CHR_PAGES];
+    TileCache* chrCache[PPU_CHR_PAGES];
+    uint8_t* nametable[4];
+    uint8_t vram[0x800];   // Console nametable RAM
+    uint8_t palette[32];
+    uint8_t oam[256];
+    uint8_t chrRamPage[PPU_CHR_PAGES]; // Which 1 KB page of CHR-RAM each writable pattern page is
+    uint32_t chrDirty;     // 256-byte pages of CHR-RAM written through $2007 since cleared
+
+    // Timing
+    int64_t time;          // Dots run so far
+    int16_t scanline;      // 0-239 visible, 241 vblank start, 261 pre-render
+    int16_t dot;           // Position within the scanline
+    bool oddFrame;
+    uint32_t frames;
+    uint32_t a12Clocks;    // Rising edges of pattern address line A12, at most one per rendered line
+
+    // Rendering
+    uint16_t lineV;        // v as fetching for the current line began
+    int16_t sprite0Start;  // Pixels of the line covered by sprite 0, empty if none
+    int16_t sprite0End;
+    uint8_t spriteLine[PPU_WIDTH];
+    uint32_t paletteArgb[32]; // Palette RAM resolved to output colours
+    ComposeFn compose;        // Background/sprite merge for this host CPU
+    uint32_t* framebuffer;    // PPU_WIDTH x PPU_HEIGHT ARGB8888 pixels; NULL draws nothing
+    int pitch;                // Pixels per framebuffer row
+} Ppu;
+
+void initPpu(Ppu* ppu);
+
+// Points a 1 KB pattern page at memory with its tile cache. ROM pages ignore
+// writes; a RAM page is page `ramPage` of the board's CHR-RAM, which is where
+// its writes are marked in chrDirty.
+void mapPpuChrRom(Ppu* ppu, int page, const uint8_t* mem, TileCache* cache);
+void mapPpuChrRam(Ppu* ppu, int page, uint8_t* mem, TileCache* cache, int ramPage);
+
+// Points one of the four logical nametables ($2000, $2400, $2800, $2C00) at 1 KB of memory.
+void mapPpuNametable(Ppu* ppu, int index, uint8_t* mem);
+
+void setPpuFramebuffer(Ppu* ppu, uint32_t* pixels, int pitch);
+
+// Runs the PPU up to dot `time`.
+void runPpu(Ppu* ppu, int64_t time);
+
+// Brings the PPU up to `time` and reads or writes one of its eight registers
+// ($2000-$2007, mirrored).
+uint8_t readPpu(Ppu* ppu, int64_t time, uint16_t addr);
+void writePpu(Ppu* ppu, int64_t time, uint16_t addr, uint8_t value);
+
+// Dot at which the next vblank begins, raising NMI when enabled.
+int64_t ppuNextEvent(const Ppu* ppu);
+
+// Dot by which a12Clocks will have grown by `n` (1 or more) if the rendering
+// settings stay as they are, or INT64_MAX when it is not counting. Scanline
+// counters (MMC3) schedule their interrupt with it.
+//
+// A12 is not followed fetch by fetch: a line clocks once, at dot 260 when
+// sprites come from $1000 (or are 8x16), else at dot 324 when the background
+// does, and not at all when both use $0000. That covers how games set up
+// these boards.
+int64_t ppuA12ClockTime(const Ppu* ppu, uint32_t n);
+
+#endif
@@ -0,0 +1,74 @@
+#include "profile.h"
+
+#include <stdbool.h>
+
+static const char* const sectionNames[PROFILE_SECTIONS] = {
+    "cpu", "ppu", "apu", "mixing", "input", "overlay", "present"
+};
+
+const char* profileSectionName(ProfileSection section) {
+    return sectionNames[section];
+}
+
+// Time outside every section: rewind recording, bookkeeping, timer overhead
+static uint64_t otherNs(const Profile* p) {
+    uint64_t sum = 0;
+    for (int i = 0; i < PROFILE_SECTIONS; ++i) sum += p->ns[i];
+    return p->totalNs > sum ? p->totalNs - sum : 0;
+}
+
+static double perFrame(const Profile* p, uint64_t ns) {
+    return p->frames ? (double)ns / p->frames : 0.0;
+}
+
+static double share(const Profile* p, uint64_t ns) {
+    return p->totalNs ? 100.0 * ns / p->totalNs : 0.0;
+}
+
+static double framesPerSecond(const Profile* p) {
+    return p->totalNs ? p->frames * 1e9 / p->totalNs : 0.0;
+}
+
+void printProfile(FILE* out, const Profile* p, const char* rom) {
+    fprintf(out, "%s: %u frames in %.3f s, %.1f frames/s, %.0f ns/frame\n",
+            rom ? rom : "(no cartridge)", p->frames, p->totalNs / 1e9, framesPerSecond(p), perFrame(p, p->totalNs));
+    for (int i = 0; i < PROFILE_SECTIONS; ++i) {
+        fprintf(out, "  %-8s %10.0f ns/frame %5.1f %%\n", sectionNames[i], perFrame(p, p->ns[i]), share(p, p->ns[i]));
+    }
+    fprintf(out, "  %-8s %10.0f ns/frame %5.1f %%\n", "other", perFrame(p, otherNs(p)), share(p, otherNs(p)));
+}
+
+static void writeJsonString(FILE* out, const char* s) {
+    fputc('"', out);
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void writeJsonSection(FILE* out, const Profile* p, const char* name, uint64_t ns, bool last) {
+    fprintf(out, "    \"%s\": { \"ns\": %llu, \"ns_per_frame\": %.1f, \"percent\": %.2f }%s\n",
+            name, (unsigned long long)ns, perFrame(p, ns), share(p, ns), last ? "" : ",");
+}
+
+void writeProfileJson(FILE* out, const Profile* p, const char* rom) {
+    fprintf(out, "{\n  \"rom\": ");
+    if (rom) {
+        writeJsonString(out, rom);
+    } else {
+        fprintf(out, "null");
+    }
+    fprintf(out, ",\n  \"frames\": %u,\n  \"total_ns\": %llu,\n  \"frames_per_second\": %.2f,\n  \"ns_per_frame\": %.1f,\n",
+            p->frames, (unsigned long long)p->totalNs, framesPerSecond(p), perFrame(p, p->totalNs));
+    fprintf(out, "  \"sections\": {\n");
+    for (int i = 0; i < PROFILE_SECTIONS; ++i) writeJsonSection(out, p, sectionNames[i], p->ns[i], false);
+    writeJsonSection(out, p, "other", otherNs(p), true);
+    fprintf(out, "  }\n}\n");
+}
@@ -0,0 +1,53 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Subsystems a benchmark run breaks its time down into
+typedef enum {
+    PROFILE_CPU,     // runNesFrame, less the PPU and APU work done inside it
+    PROFILE_PPU,     // Catch-ups, register accesses and OAM DMA
+    PROFILE_APU,     // Channel synthesis into the blip buffer
+    PROFILE_MIXING,  // Resampling the blip buffer and queueing the samples
+    PROFILE_INPUT,   // Host events and the HUD's controller reads
+    PROFILE_OVERLAY, // The performance HUD (renderPerfHud)
+    PROFILE_PRESENT, // Frame upload with SDL_UpdateTexture, copy and SDL_RenderPresent
+    PROFILE_SECTIONS
+} ProfileSection;
+
+// Wall-clock time spent per subsystem. Code that owns a section brackets it
+// with beginProfile/endProfile on a Profile pointer kept beside the state it
+// works on; the pointer is NULL except in benchmark runs, so unprofiled runs
+// pay one predictable branch per bracket.
+typedef struct {
+    uint64_t ns[PROFILE_SECTIONS];
+    uint64_t totalNs;   // Whole host frames, sections and everything else
+    uint32_t frames;
+} Profile;
+
+static inline uint64_t profileClock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t beginProfile(const Profile* profile) {
+    return profile ? profileClock() : 0;
+}
+
+static inline void endProfile(Profile* profile, ProfileSection section, uint64_t start) {
+    if (profile) profile->ns[section] += profileClock() - start;
+}
+
+// Lowercase section name, as used in reports
+const char* profileSectionName(ProfileSection section);
+
+// Writes the frame rate, time per frame and per-section breakdown of a run,
+// as aligned text for people or as one JSON object for tools. `rom` names the
+// workload and may be NULL.
+void printProfile(FILE* out, const Profile* profile, const char* rom);
+void writeProfileJson(FILE* out, const Profile* profile, const char* rom);
+
+#endif
@@ -0,0 +1,22 @@
+#include "rate_control.h"
+
+void initRateControl(RateControl* rc, double sampleRate, int targetFill) {
+    rc->sampleRate = sampleRate;
+    rc->target = targetFill;
+    rc->fill = targetFill;
+    rc->rate = sampleRate;
+}
+
+double updateRateControl(RateControl* rc, int fill) {
+    // The fill level is sampled at an arbitrary point of the callback's
+    // drain cycle, so single readings are smoothed before acting on them.
+    rc->fill += (fill - rc->fill) * RATE_CONTROL_SMOOTHING;
+
+    double error = (rc->target - rc->fill) / rc->target;
+    if (error > 1.0) error = 1.0;
+    if (error < -1.0) error = -1.0;
+
+    // Below target, produce slightly more samples per emulated second
+    rc->rate = rc->sampleRate * (1.0 + error * RATE_CONTROL_MAX_DEVIATION);
+    return rc->rate;
+}
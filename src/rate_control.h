@@ -0,0 +1,26 @@
+#ifndef RATE_CONTROL_H
+#define RATE_CONTROL_H
+
+// Dynamic rate control. The emulator produces audio at the video frame rate
+// while the sound card consumes it on its own clock; the two never match
+// exactly, so with a small device buffer the ring slowly overflows or runs dry.
+// Once per frame the ring fill level is compared to a target depth and the
+// resampling rate is nudged by at most RATE_CONTROL_MAX_DEVIATION to steer the
+// fill back. The resulting pitch change is far below what is audible.
+#define RATE_CONTROL_MAX_DEVIATION 0.005 // +/- 0.5 %
+#define RATE_CONTROL_SMOOTHING 0.05      // Weight of each new fill measurement
+
+typedef struct {
+    double sampleRate; // Nominal output rate
+    double target;     // Desired ring fill, in samples
+    double fill;       // Smoothed fill measurement
+    double rate;       // Output rate currently in effect
+} RateControl;
+
+void initRateControl(RateControl* rc, double sampleRate, int targetFill);
+
+// Feeds one fill measurement and returns the output sample rate the resampler
+// should use for the next frame.
+double updateRateControl(RateControl* rc, int fill);
+
+#endif
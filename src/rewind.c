@@ -0,0 +1,185 @@
+#include "rewind.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Encoding: a control byte below 0x80 starts a run of unchanged bytes, its low
+// seven bits and the next byte giving the run length - 1 (up to 32768); 0x80
+// and above is followed by (c & 0x7F) + 1 bytes XORed with the reference.
+#define RLE_MAX_SKIP 0x8000
+#define RLE_MAX_LITERAL 0x80
+#define RLE_MIN_SKIP 3 // Shortest run a skip token (2 bytes) saves space on
+
+#define STATE_SIZE sizeof(EmuState)
+// Skips never grow the data, so the worst case is one control byte per literal
+#define MAX_ENCODED_SIZE (STATE_SIZE + STATE_SIZE / RLE_MAX_LITERAL + 1)
+
+static const EmuState zeroState; // Reference keyframes are encoded against
+
+static inline uint64_t load64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Unchanged bytes from i, compared a word at a time where possible
+static size_t matchLength(const uint8_t* cur, const uint8_t* ref, size_t i, size_t size) {
+    size_t j = i;
+    while (j + 8 <= size && load64(cur + j) == load64(ref + j)) j += 8;
+    while (j < size && cur[j] == ref[j]) j++;
+    return j - i;
+}
+
+// Whether an unchanged run worth a skip token starts at i: RLE_MIN_SKIP bytes,
+// or everything up to the end
+static inline bool skipStarts(const uint8_t* cur, const uint8_t* ref, size_t i, size_t size) {
+    size_t n = size - i < RLE_MIN_SKIP ? size - i : RLE_MIN_SKIP;
+    for (size_t k = 0; k < n; ++k) {
+        if (cur[i + k] != ref[i + k]) return false;
+    }
+    return true;
+}
+
+static size_t encodeState(uint8_t* out, const uint8_t* cur, const uint8_t* ref, size_t size) {
+    uint8_t* o = out;
+    size_t i = 0;
+
+    while (i < size) {
+        size_t run = matchLength(cur, ref, i, size);
+        if (i + run == size) break; // The decoder starts from the reference, so the tail needs no token
+        if (run >= RLE_MIN_SKIP) {
+            i += run;
+            while (run > 0) {
+                size_t n = run < RLE_MAX_SKIP ? run : RLE_MAX_SKIP;
+                *o++ = (uint8_t)((n - 1) >> 8);
+                *o++ = (uint8_t)(n - 1);
+                run -= n;
+            }
+        }
+
+        // Shorter unchanged stretches are cheaper carried in the literal
+        size_t start = i;
+        while (i < size && i - start < RLE_MAX_LITERAL && (i == start || !skipStarts(cur, ref, i, size))) i++;
+        *o++ = (uint8_t)(0x80 | (i - start - 1));
+        for (size_t k = start; k < i; ++k) *o++ = cur[k] ^ ref[k];
+    }
+    return (size_t)(o - out);
+}
+
+static void decodeState(uint8_t* out, const uint8_t* in, size_t length, const uint8_t* ref, size_t size) {
+    const uint8_t* end = in + length;
+    size_t i = 0;
+
+    memcpy(out, ref, size);
+    while (in < end) {
+        uint8_t c = *in++;
+        if (c < 0x80) {
+            i += ((size_t)c << 8 | *in++) + 1;
+        } else {
+            size_t n = (size_t)(c & 0x7F) + 1;
+            for (size_t k = 0; k < n; ++k) out[i + k] ^= in[k];
+            in += n;
+            i += n;
+        }
+    }
+}
+
+static inline RewindEntry* entryAt(Rewind* rewind, uint32_t index) {
+    return &rewind->entries[(rewind->first + index) % rewind->maxEntries];
+}
+
+bool initRewind(Rewind* rewind, size_t bytes, uint32_t frames) {
+    memset(rewind, 0, sizeof(*rewind));
+    if (bytes < MAX_ENCODED_SIZE || bytes > UINT32_MAX || frames == 0) return false;
+
+    rewind->buffer = malloc(bytes);
+    rewind->entries = malloc(sizeof(RewindEntry) * frames);
+    if (!rewind->buffer || !rewind->entries) {
+        destroyRewind(rewind);
+        return false;
+    }
+    rewind->capacity = bytes;
+    rewind->maxEntries = frames;
+    return true;
+}
+
+void destroyRewind(Rewind* rewind) {
+    free(rewind->buffer);
+    free(rewind->entries);
+    rewind->buffer = NULL;
+    rewind->entries = NULL;
+    rewind->count = 0;
+}
+
+static void dropOldest(Rewind* rewind) {
+    rewind->first = (rewind->first + 1) % rewind->maxEntries;
+    rewind->count--;
+}
+
+// Deltas cannot be decoded without their keyframe, so history always starts with one
+static void dropPartialGroup(Rewind* rewind) {
+    while (rewind->count > 0 && !entryAt(rewind, 0)->key) dropOldest(rewind);
+}
+
+// Makes room for one more entry of up to MAX_ENCODED_SIZE bytes at head.
+static void reserveEntry(Rewind* rewind) {
+    if (rewind->head + MAX_ENCODED_SIZE > rewind->capacity) {
+        // Entries are never split: wrap, dropping what lies past the old head
+        // (the oldest entries) first
+        while (rewind->count > 0 && entryAt(rewind, 0)->offset >= rewind->head) dropOldest(rewind);
+        rewind->head = 0;
+    }
+    while (rewind->count > 0 && entryAt(rewind, 0)->offset >= rewind->head &&
+           entryAt(rewind, 0)->offset < rewind->head + MAX_ENCODED_SIZE) {
+        dropOldest(rewind);
+    }
+    if (rewind->count == rewind->maxEntries) dropOldest(rewind);
+    dropPartialGroup(rewind);
+    if (rewind->count == 0) rewind->sinceKey = REWIND_KEYFRAME_INTERVAL;
+}
+
+void captureRewind(Rewind* rewind, EmuContext* emu) {
+    if (!rewind->buffer) return;
+
+    updateEmuState(emu, &rewind->current);
+    reserveEntry(rewind);
+
+    bool key = rewind->sinceKey >= REWIND_KEYFRAME_INTERVAL - 1;
+    if (key) {
+        memcpy(&rewind->key, &rewind->current, STATE_SIZE);
+        rewind->sinceKey = 0;
+    } else {
+        rewind->sinceKey++;
+    }
+    const uint8_t* ref = key ? (const uint8_t*)&zeroState : (const uint8_t*)&rewind->key;
+
+    RewindEntry* entry = entryAt(rewind, rewind->count++);
+    entry->offset = (uint32_t)rewind->head;
+    entry->size = (uint32_t)encodeState(rewind->buffer + rewind->head, (const uint8_t*)&rewind->current, ref, STATE_SIZE);
+    entry->key = key;
+    rewind->head += entry->size;
+}
+
+bool stepRewind(Rewind* rewind, EmuContext* emu) {
+    if (!rewind->buffer || rewind->count == 0) return false;
+
+    RewindEntry* entry = entryAt(rewind, rewind->count - 1);
+    const uint8_t* ref = entry->key ? (const uint8_t*)&zeroState : (const uint8_t*)&rewind->key;
+    decodeState((uint8_t*)&rewind->current, rewind->buffer + entry->offset, entry->size, ref, STATE_SIZE);
+    loadEmuState(emu, &rewind->current);
+    if (rewind->count == 1) return true;
+
+    rewind->count--;
+    rewind->head = entry->offset;
+    if (entry->key) {
+        // The group before is decoded against its own keyframe
+        uint32_t i = rewind->count - 1;
+        while (!entryAt(rewind, i)->key) i--;
+        RewindEntry* key = entryAt(rewind, i);
+        decodeState((uint8_t*)&rewind->key, rewind->buffer + key->offset, key->size, (const uint8_t*)&zeroState, STATE_SIZE);
+        rewind->sinceKey = rewind->count - 1 - i;
+    } else {
+        rewind->sinceKey--;
+    }
+    return true;
+}
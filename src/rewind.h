@@ -0,0 +1,52 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "emu.h"
+
+#define REWIND_KEYFRAME_INTERVAL 60 // Frames per keyframe
+
+typedef struct {
+    uint32_t offset;       // Position of the encoded state in the buffer
+    uint32_t size;
+    bool key;
+} RewindEntry;
+
+// Frame history in a fixed amount of memory. After every frame the session's
+// state is captured: every REWIND_KEYFRAME_INTERVAL frames as a keyframe, and
+// otherwise as the XOR of the state with the latest keyframe. Consecutive
+// frames differ in little more than the CPU registers and a few RAM pages, so
+// a delta is mostly zero bytes, and both kinds are run-length encoded. The
+// encoded states fill a byte ring; when it or the entry table is full, the
+// oldest frames are dropped a keyframe group at a time.
+//
+// Rewinding pops frames newest first and loads them into the session.
+typedef struct {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t head;           // Where the next entry is written
+    RewindEntry* entries;  // Circular, oldest first
+    uint32_t maxEntries;
+    uint32_t first;
+    uint32_t count;
+    uint32_t sinceKey;     // Entries after the newest keyframe
+    EmuState current;      // Session state as of the last capture
+    EmuState key;          // Newest keyframe, decoded
+} Rewind;
+
+// Keeps up to `frames` frames of history in `bytes` bytes of encoded states.
+bool initRewind(Rewind* rewind, size_t bytes, uint32_t frames);
+void destroyRewind(Rewind* rewind);
+
+// Records the state the session has reached at the end of a frame.
+void captureRewind(Rewind* rewind, EmuContext* emu);
+
+// Loads the newest recorded frame into the session and forgets it, so that
+// repeated calls walk backwards; the oldest frame is kept and loaded again and
+// again. Returns false when nothing has been recorded.
+bool stepRewind(Rewind* rewind, EmuContext* emu);
+
+#endif
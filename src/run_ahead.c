@@ -0,0 +1,29 @@
+#include "run_ahead.h"
+
+#include <string.h>
+
+void initRunAhead(RunAhead* ahead, int frames) {
+    memset(ahead, 0, sizeof(*ahead));
+    ahead->frames = frames;
+}
+
+int runAheadFrame(RunAhead* ahead, EmuContext* emu, int16_t* samples) {
+    Ppu* ppu = &emu->nes.ppu;
+    uint32_t* framebuffer = ppu->framebuffer;
+    int pitch = ppu->pitch;
+
+    // The pads stay as the caller set them, so every frame runs with them
+    ahead->heard = emu->blip;
+    setPpuFramebuffer(ppu, NULL, 0);
+    runEmuFrame(emu, samples);
+    saveEmuState(emu, &ahead->state);
+    for (int i = 1; i < ahead->frames; ++i) {
+        runEmuFrame(emu, samples);
+    }
+
+    emu->blip = ahead->heard;
+    setPpuFramebuffer(ppu, framebuffer, pitch);
+    int numSamples = runEmuFrame(emu, samples);
+    loadEmuState(emu, &ahead->state);
+    return numSamples;
+}
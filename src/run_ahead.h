@@ -0,0 +1,36 @@
+#ifndef RUN_AHEAD_H
+#define RUN_AHEAD_H
+
+#include <stdint.h>
+
+#include "blip_buffer.h"
+#include "emu.h"
+
+#define RUN_AHEAD_MAX 4 // Frames the picture may be shown ahead of the session
+
+// Run-ahead hides the input lag games build in: most take a frame or more to
+// act on a button press, so the picture is shown from a few frames later. Each
+// host frame runs the real frame without drawing, saves the session, runs
+// `frames` more with the same input (only the last one drawn), and loads the
+// saved state back. What is seen and heard is the speculative frame; the
+// session itself only ever advances by the real one.
+//
+// Speculative audio needs a sample stream of its own. The session's blip
+// buffer is set aside while the real frame and all but the last speculative
+// frame run, and put back for the last one, so the stream that is heard gets
+// one frame per host frame and carries on where the previous one ended. The
+// audio of the other frames is synthesized and dropped.
+typedef struct {
+    int frames;            // Frames shown ahead, 1-RUN_AHEAD_MAX; 0 is off
+    EmuState state;        // The session after its real frame
+    BlipBuffer heard;      // The session's stream, set aside while unheard frames run
+} RunAhead;
+
+void initRunAhead(RunAhead* ahead, int frames);
+
+// Emulates one host frame ahead. The picture goes to the PPU framebuffer as
+// set by the caller, the heard audio into `samples` (room for
+// BLIP_MAX_SAMPLES). Returns the number of samples.
+int runAheadFrame(RunAhead* ahead, EmuContext* emu, int16_t* samples);
+
+#endif
@@ -0,0 +1,60 @@
+#include "savestate.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(NesState) == offsetof(Nes, chrCache), "NesState must mirror the front of Nes");
+
+// Leaves the bus and PPU dirty bits relative to the state just taken.
+static void clearDirty(Nes* nes) {
+    clearBusDirty(&nes->bus);
+    nes->ppu.chrDirty = 0;
+}
+
+void saveNesState(Nes* nes, NesState* state) {
+    clearDirty(nes);
+    memcpy(state, nes, sizeof(*state));
+}
+
+// Copies the 256-byte pages whose bits are set in `dirty`.
+static void copyDirtyPages(uint8_t* dst, const uint8_t* src, uint32_t dirty) {
+    while (dirty) {
+        unsigned page = (unsigned)__builtin_ctz(dirty);
+        memcpy(dst + page * SAVESTATE_PAGE_SIZE, src + page * SAVESTATE_PAGE_SIZE, SAVESTATE_PAGE_SIZE);
+        dirty &= dirty - 1;
+    }
+}
+
+void updateNesState(Nes* nes, NesState* state) {
+    // Work RAM is mirrored four times over $0000-$1FFF: pages 0-31 of the
+    // bus fold onto its 8
+    uint32_t ramDirty = (uint32_t)nes->bus.dirty[0];
+    ramDirty |= ramDirty >> 16;
+    ramDirty |= ramDirty >> 8;
+    uint32_t prgRamDirty = (uint32_t)(nes->bus.dirty[1] >> 32); // $6000-$7FFF
+    uint32_t chrDirty = nes->ppu.chrDirty;
+
+    clearDirty(nes);
+    memcpy(state->core, nes, sizeof(state->core));
+    copyDirtyPages(state->ram, nes->ram, ramDirty & 0xFF);
+    copyDirtyPages(state->prgRam, nes->prgRam, prgRamDirty);
+    copyDirtyPages(state->chrRam, nes->chrRam, chrDirty);
+}
+
+void loadNesState(Nes* nes, const NesState* state) {
+    uint32_t* framebuffer = nes->ppu.framebuffer;
+    int pitch = nes->ppu.pitch;
+    Profile* profile = nes->profile;
+
+    memcpy(nes, state, sizeof(*state));
+    nes->ppu.framebuffer = framebuffer;
+    nes->ppu.pitch = pitch;
+    nes->profile = profile;
+
+    // Memory may now differ from any snapshot taken since, on every page, and
+    // every CHR-RAM tile cache, mapped or not, may hold another timeline's tiles
+    memset(nes->bus.dirty, 0xFF, sizeof(nes->bus.dirty));
+    nes->ppu.chrDirty = UINT32_MAX;
+    for (int page = 0; page < PPU_CHR_PAGES; ++page) {
+        nes->chrCache[page].valid = 0;
+    }
+}
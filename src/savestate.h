@@ -0,0 +1,36 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nes.h"
+
+#define SAVESTATE_PAGE_SIZE (1 << BUS_DIRTY_BITS)
+
+// Machine snapshot. Every piece of emulated state already lives in the Nes
+// struct as plain fields, so a snapshot is that struct's bytes up to the tile
+// caches: one memcpy, about 23 KB. The layout is fixed, but it holds host
+// pointers (page tables, the blip buffer), so a state only loads back into
+// the Nes it was taken from.
+typedef struct {
+    uint8_t core[offsetof(Nes, ram)]; // CPU, APU, PPU, bus and controller state
+    uint8_t ram[NES_RAM_SIZE];
+    uint8_t prgRam[NES_PRG_RAM_SIZE];
+    uint8_t chrRam[NES_CHR_RAM_SIZE];
+} NesState;
+
+// Copies the whole machine into `state` and starts tracking writes from here.
+void saveNesState(Nes* nes, NesState* state);
+
+// Brings `state`, which must hold the last snapshot taken of `nes`, up to the
+// present. The core is copied whole; of the RAMs only the 256-byte
+// pages written since then are, using the bus and PPU dirty bits. This is the
+// cheap one to call every frame.
+void updateNesState(Nes* nes, NesState* state);
+
+// Restores the machine from `state`. The framebuffer the PPU draws into is
+// host state and kept; CHR-RAM tile caches are marked stale.
+void loadNesState(Nes* nes, const NesState* state);
+
+#endif
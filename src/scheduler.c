@@ -0,0 +1,78 @@
+#include "scheduler.h"
+
+#include <stdbool.h>
+
+static inline bool before(const Scheduler* s, int a, int b) {
+    return s->time[a] < s->time[b] || (s->time[a] == s->time[b] && a < b);
+}
+
+static inline void place(Scheduler* s, int pos, int id) {
+    s->heap[pos] = (uint8_t)id;
+    s->index[id] = (uint8_t)pos;
+}
+
+static void siftUp(Scheduler* s, int pos) {
+    int id = s->heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!before(s, id, s->heap[parent])) break;
+        place(s, pos, s->heap[parent]);
+        pos = parent;
+    }
+    place(s, pos, id);
+}
+
+static void siftDown(Scheduler* s, int pos) {
+    int id = s->heap[pos];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= s->count) break;
+        if (child + 1 < s->count && before(s, s->heap[child + 1], s->heap[child])) child++;
+        if (!before(s, s->heap[child], id)) break;
+        place(s, pos, s->heap[child]);
+        pos = child;
+    }
+    place(s, pos, id);
+}
+
+// Takes the source at heap position `pos` out of the queue.
+static void removeAt(Scheduler* s, int pos) {
+    int id = s->heap[pos];
+    s->time[id] = EVENT_NEVER;
+    if (--s->count == pos) return;
+
+    // The last entry fills the hole and may belong above or below it
+    int last = s->heap[s->count];
+    place(s, pos, last);
+    siftDown(s, pos);
+    siftUp(s, s->index[last]);
+}
+
+void initScheduler(Scheduler* s) {
+    for (int id = 0; id < EVENT_COUNT; ++id) s->time[id] = EVENT_NEVER;
+    s->count = 0;
+}
+
+void scheduleEvent(Scheduler* s, EventId id, int64_t time) {
+    bool queued = s->time[id] != EVENT_NEVER;
+
+    if (time == EVENT_NEVER) {
+        if (queued) removeAt(s, s->index[id]);
+        return;
+    }
+    s->time[id] = time;
+    if (!queued) {
+        place(s, s->count++, id);
+        siftUp(s, s->index[id]);
+    } else {
+        siftUp(s, s->index[id]);
+        siftDown(s, s->index[id]);
+    }
+}
+
+int popDueEvent(Scheduler* s, int64_t now) {
+    if (s->count == 0 || s->time[s->heap[0]] > now) return -1;
+    int id = s->heap[0];
+    removeAt(s, 0);
+    return id;
+}
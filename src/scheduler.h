@@ -0,0 +1,42 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#define EVENT_NEVER INT64_MAX // Event time of a source with nothing pending
+
+// Sources of timed events, one pending event each. Ties go in this order.
+typedef enum {
+    EVENT_VBLANK,     // PPU vblank begins: NMI and the end of the frame
+    EVENT_MAPPER_IRQ, // The board's interrupt is raised
+    EVENT_DMC_FETCH,  // The DMC wants its next sample byte
+    EVENT_APU_FRAME,  // A frame sequencer step that may raise the frame interrupt
+    EVENT_COUNT
+} EventId;
+
+// Event queue on the CPU clock: a binary min-heap of event sources ordered by
+// (time, id). Every source has one slot and a handler reschedules its own
+// event, so the queue never allocates and moving an event is a sift in place.
+// Times are absolute CPU cycles.
+typedef struct {
+    int64_t time[EVENT_COUNT];  // Per source, EVENT_NEVER when not queued
+    uint8_t heap[EVENT_COUNT];  // Queued sources, earliest first
+    uint8_t index[EVENT_COUNT]; // Position of each queued source in heap
+    uint8_t count;
+} Scheduler;
+
+void initScheduler(Scheduler* s);
+
+// Queues, moves or (with EVENT_NEVER) cancels the event of source `id`.
+void scheduleEvent(Scheduler* s, EventId id, int64_t time);
+
+// Time of the earliest queued event, EVENT_NEVER when there is none.
+static inline int64_t nextEventTime(const Scheduler* s) {
+    return s->count ? s->time[s->heap[0]] : EVENT_NEVER;
+}
+
+// Dequeues the earliest event if it is due by `now` and returns its source,
+// or -1 when nothing is due.
+int popDueEvent(Scheduler* s, int64_t now);
+
+#endif
@@ -0,0 +1,43 @@
+#include "swap_chain.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#define SWAP_FRESH 4 // Flag beside the parked index: published and not yet acquired
+
+bool initSwapChain(SwapChain* chain) {
+    memset(chain->frames, 0, sizeof(chain->frames));
+    chain->back = 0;
+    chain->middle = 1;
+    chain->front = 2;
+    return sem_init(&chain->published, 0, 0) == 0;
+}
+
+void destroySwapChain(SwapChain* chain) {
+    sem_destroy(&chain->published);
+}
+
+void publishSwapFrame(SwapChain* chain) {
+    int parked = atomic_exchange_explicit(&chain->middle, chain->back | SWAP_FRESH, memory_order_acq_rel);
+    chain->back = parked & ~SWAP_FRESH;
+    sem_post(&chain->published);
+}
+
+const SwapFrame* acquireSwapFrame(SwapChain* chain, int timeoutMs) {
+    if (!(atomic_load_explicit(&chain->middle, memory_order_acquire) & SWAP_FRESH) && timeoutMs > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)timeoutMs * 1000000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        while (sem_timedwait(&chain->published, &deadline) != 0 && errno == EINTR) {}
+    }
+    // Posts only wake the consumer; whatever has piled up is covered by this look
+    while (sem_trywait(&chain->published) == 0) {}
+
+    if (!(atomic_load_explicit(&chain->middle, memory_order_acquire) & SWAP_FRESH)) return NULL;
+    int parked = atomic_exchange_explicit(&chain->middle, chain->front, memory_order_acq_rel);
+    chain->front = parked & ~SWAP_FRESH;
+    return &chain->frames[chain->front];
+}
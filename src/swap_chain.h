@@ -0,0 +1,54 @@
+#ifndef SWAP_CHAIN_H
+#define SWAP_CHAIN_H
+
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "input.h"
+#include "ppu.h"
+
+#define SWAP_CHAIN_BUFFERS 3
+
+// A finished picture and what the presenter shows alongside it
+typedef struct {
+    uint32_t pixels[PPU_WIDTH * PPU_HEIGHT];
+    uint32_t emulatedFrames;   // Frames the session had emulated when it was done
+    uint32_t hostFrames;       // Frames the emulation loop had run, and how many were late
+    uint32_t lateFrames;
+    uint8_t pads[INPUT_PORTS]; // Controller bytes the frame ran with
+} SwapFrame;
+
+// Triple-buffered hand-off of frames from the emulation thread to the
+// presenting thread. The producer owns the back buffer and the consumer the
+// front one; the third is parked in `middle`. Publishing swaps the back buffer
+// with the parked one and flags it fresh, acquiring swaps the front buffer
+// with a fresh parked one, each with one atomic exchange. Neither side ever
+// waits for the other: the producer always has a free buffer, and a consumer
+// that falls behind just skips to the newest frame.
+typedef struct {
+    SwapFrame frames[SWAP_CHAIN_BUFFERS];
+    int back;               // Producer only
+    int front;              // Consumer only
+    _Atomic int middle;     // Parked buffer index, plus SWAP_FRESH when unseen
+    sem_t published;        // Posted once per frame, to wake a waiting consumer
+} SwapChain;
+
+bool initSwapChain(SwapChain* chain);
+void destroySwapChain(SwapChain* chain);
+
+// The buffer the producer draws the next frame into
+static inline SwapFrame* swapChainBack(SwapChain* chain) {
+    return &chain->frames[chain->back];
+}
+
+// Hands the back buffer over as the newest frame.
+void publishSwapFrame(SwapChain* chain);
+
+// Returns the newest frame published since the last call, waiting up to
+// `timeoutMs` for one, or NULL if none came. The frame stays valid until the
+// next call.
+const SwapFrame* acquireSwapFrame(SwapChain* chain, int timeoutMs);
+
+#endif
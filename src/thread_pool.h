@@ -0,0 +1,39 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+typedef void (*PoolTaskFn)(void* arg, int index);
+
+// Fixed set of worker threads that run batches of independent tasks. A batch
+// hands out task indices through one atomic counter, so a thread that finishes
+// early just takes the next index; the calling thread works on the batch too.
+typedef struct {
+    pthread_t* threads;
+    int numThreads;        // Workers besides the calling thread
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned generation;   // Bumped for every batch
+    int busy;              // Workers still inside the current batch
+    bool quit;
+
+    PoolTaskFn fn;
+    void* arg;
+    int count;
+    _Atomic int next;      // Next task index to hand out
+} ThreadPool;
+
+// Starts `threads` - 1 workers, so `threads` in total run each batch.
+bool initThreadPool(ThreadPool* pool, int threads);
+void destroyThreadPool(ThreadPool* pool);
+
+// Runs fn(arg, i) for every i in 0..count-1 and returns when all are done.
+void runThreadPool(ThreadPool* pool, PoolTaskFn fn, void* arg, int count);
+
+// Online CPUs, at least 1
+int countCpus(void);
+
+#endif
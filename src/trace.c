@@ -0,0 +1,94 @@
+#include "trace.h"
+
+#ifdef VERSANES_TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRACE_DUMP_MARGIN 1024 // Slots of a full ring not dumped, see dumpTrace
+
+_Thread_local TraceRing* traceRing;
+_Thread_local bool traceRegistered;
+
+static TraceRing* _Atomic rings[TRACE_MAX_THREADS];
+static _Atomic int ringCount;
+
+// Clock pair taken when the first thread registers; dumps convert cycles to
+// time with the rate measured since, and show times relative to it.
+static uint64_t epochTicks;
+static struct timespec epochTime;
+static atomic_flag epochTaken = ATOMIC_FLAG_INIT;
+static _Atomic bool epochReady;
+
+static double secondsSince(const struct timespec* t) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - t->tv_sec) + (now.tv_nsec - t->tv_nsec) / 1e9;
+}
+
+TraceRing* registerTraceThread(void) {
+    if (traceRegistered) return traceRing;
+    traceRegistered = true;
+
+    if (!atomic_flag_test_and_set(&epochTaken)) {
+        clock_gettime(CLOCK_MONOTONIC, &epochTime);
+        epochTicks = traceClock();
+        atomic_store(&epochReady, true);
+    }
+
+    int index = atomic_fetch_add(&ringCount, 1);
+    if (index >= TRACE_MAX_THREADS) return NULL;
+    TraceRing* ring = calloc(1, sizeof(TraceRing));
+    if (!ring) return NULL;
+    ring->tid = index + 1;
+    rings[index] = ring;
+    traceRing = ring;
+    return ring;
+}
+
+void nameTraceThread(const char* name) {
+    TraceRing* ring = traceRing ? traceRing : registerTraceThread();
+    if (ring) ring->name = name;
+}
+
+// Writes the records of one ring that are safe to read, oldest first.
+static void writeRing(FILE* out, const TraceRing* ring, double usPerTick, bool* first) {
+    uint64_t count = atomic_load_explicit(&ring->count, memory_order_acquire);
+    uint64_t begin = count > TRACE_RING_RECORDS - TRACE_DUMP_MARGIN ? count - (TRACE_RING_RECORDS - TRACE_DUMP_MARGIN) : 0;
+
+    if (ring->name) {
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                *first ? "" : ",", ring->tid, ring->name);
+        *first = false;
+    }
+    for (uint64_t i = begin; i < count; ++i) {
+        const TraceRecord* r = &ring->records[i & (TRACE_RING_RECORDS - 1)];
+        if (r->start < epochTicks) continue;
+        fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                *first ? "" : ",", r->name, ring->tid,
+                (r->start - epochTicks) * usPerTick, (r->end - r->start) * usPerTick);
+        *first = false;
+    }
+}
+
+bool dumpTrace(const char* path) {
+    if (!atomic_load(&epochReady)) return false;
+    uint64_t ticks = traceClock() - epochTicks;
+    double seconds = secondsSince(&epochTime);
+    if (ticks == 0 || seconds <= 0) return false;
+    double usPerTick = seconds * 1e6 / ticks;
+
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    int count = atomic_load(&ringCount);
+    for (int i = 0; i < count && i < TRACE_MAX_THREADS; ++i) {
+        if (rings[i]) writeRing(out, rings[i], usPerTick, &first);
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+#endif
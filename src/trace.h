@@ -0,0 +1,112 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+// Hot-path tracing, compiled in with -DVERSANES_TRACE and absent otherwise.
+//
+//     TRACE_SCOPE("present") SDL_RenderPresent(renderer);
+//
+// times the statement (or block) that follows with the CPU's cycle counter
+// and appends a record to a ring owned by the calling thread, so recording
+// takes no lock and touches no shared cache line. Each ring keeps the last
+// TRACE_RING_RECORDS records. TRACE_DUMP writes every thread's ring as a
+// Chrome trace (load it in about:tracing or ui.perfetto.dev), converting
+// cycles to microseconds against the monotonic clock.
+//
+// Without VERSANES_TRACE the macros expand to nothing, or to false for
+// TRACE_DUMP, and no trace code is built.
+#ifdef VERSANES_TRACE
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define TRACE_RING_RECORDS 65536 // Per thread, a power of two
+#define TRACE_MAX_THREADS 16     // Threads beyond this are not traced
+
+typedef struct {
+    uint64_t start, end;         // traceClock() values
+    const char* name;            // A string literal
+} TraceRecord;
+
+typedef struct {
+    TraceRecord records[TRACE_RING_RECORDS];
+    _Atomic uint64_t count;      // Records ever written; published after each one
+    const char* name;            // Thread name shown in the viewer, NULL for a number
+    int tid;
+} TraceRing;
+
+typedef struct {
+    uint64_t start;
+    const char* name;
+    bool live;                   // Cleared once the scope has run
+} TraceScope;
+
+extern _Thread_local TraceRing* traceRing;
+extern _Thread_local bool traceRegistered; // Registration was attempted, whether or not a ring was left
+
+// Gives the calling thread its ring, or returns NULL when all are taken. Only
+// the first call of a thread does anything.
+TraceRing* registerTraceThread(void);
+
+static inline uint64_t traceClock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline TraceScope beginTrace(const char* name) {
+    return (TraceScope){ traceClock(), name, true };
+}
+
+static inline void endTrace(TraceScope* scope) {
+    uint64_t end = traceClock();
+    scope->live = false;
+
+    TraceRing* ring = traceRing;
+    if (!ring) {
+        // A thread that found every ring taken stays untraced without
+        // touching the shared counter again
+        if (traceRegistered) return;
+        ring = registerTraceThread();
+        if (!ring) return;
+    }
+    uint64_t n = atomic_load_explicit(&ring->count, memory_order_relaxed);
+    ring->records[n & (TRACE_RING_RECORDS - 1)] = (TraceRecord){ scope->start, end, scope->name };
+    atomic_store_explicit(&ring->count, n + 1, memory_order_release);
+}
+
+// Names the calling thread in dumps. Cheap to call repeatedly.
+void nameTraceThread(const char* name);
+
+// Writes all rings to `path`. Threads keep recording meanwhile; the oldest
+// records of a busy ring may be overwritten as they are read, so a dump
+// leaves out the first TRACE_DUMP_MARGIN slots of each full ring.
+bool dumpTrace(const char* path);
+
+#define TRACE_SCOPE(name) \
+    for (TraceScope traceScope_ = beginTrace(name); traceScope_.live; endTrace(&traceScope_))
+#define TRACE_THREAD(name) nameTraceThread(name)
+#define TRACE_DUMP(path) dumpTrace(path)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD(name) ((void)0)
+#define TRACE_DUMP(path) false
+
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#include "video.h"
+
+bool initVideo(Video* video, SDL_Renderer* renderer) {
+    video->valid = false;
+    video->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                       PPU_WIDTH, PPU_HEIGHT);
+    return video->texture != NULL;
+}
+
+void destroyVideo(Video* video) {
+    if (video->texture) SDL_DestroyTexture(video->texture);
+    video->texture = NULL;
+}
+
+void uploadVideoFrame(Video* video, const uint32_t* pixels) {
+    if (SDL_UpdateTexture(video->texture, NULL, pixels, PPU_WIDTH * (int)sizeof(uint32_t)) == 0) {
+        video->valid = true;
+    }
+}
+
+void drawVideo(SDL_Renderer* renderer, Video* video) {
+    if (video->valid) SDL_RenderCopy(renderer, video->texture, NULL, NULL);
+}
@@ -0,0 +1,27 @@
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#include "ppu.h"
+
+// Emulated picture output through one streaming texture. The PPU draws into
+// memory of its own (see swap_chain.h); a finished frame is uploaded with one
+// update and presented with a single scaled copy done by the GPU. Nothing is
+// allocated per frame.
+typedef struct {
+    SDL_Texture* texture;
+    bool valid;   // Holds a frame; until then nothing is drawn
+} Video;
+
+bool initVideo(Video* video, SDL_Renderer* renderer);
+void destroyVideo(Video* video);
+
+// Replaces the picture with PPU_WIDTH x PPU_HEIGHT ARGB8888 pixels.
+void uploadVideoFrame(Video* video, const uint32_t* pixels);
+
+// Copies the picture to the whole render target.
+void drawVideo(SDL_Renderer* renderer, Video* video);
+
+#endif